@@ -13,9 +13,10 @@ extern "C" {
     void vectrex_emulator_pause(void);
     void vectrex_emulator_resume(void);
     void vectrex_emulator_key(int vk, int pressed);
+    void vectrex_emulator_debug_command(int command, int parameter);
 
-    void vectrex_add_line(int x1, int y1, int x2, int y2, uint8_t color) {
-        GAME_INSTANCE->AddLine(x1, y1, x2, y2, color);
+    void vectrex_display_list(const display_list_t* list) {
+        GAME_INSTANCE->SetDisplayList(list);
     }
 }
 
@@ -49,6 +50,9 @@ void CGame::LoadGame() {
         vectrex_emulator_init((int)window->Bounds.Width, (int)window->Bounds.Height);
         vectrex_emulator_start("romfast.bin", "fastrom", gameFile.c_str(), name.c_str());
     }
+
+    // connected vectors arrive as line strips
+    vectrex_emulator_debug_command(DEBUG_VECTOR_MERGE, 1);
 }
 
 void CGame::NextGame() {
@@ -132,11 +136,30 @@ void CGame::Initialize() {
 }
 
 void CGame::RemapVertexBuffer() {
+    if (!m_verticesChanged) {
+        return;
+    }
+
+    if (m_vertices.size() > m_vertexCapacity) {
+        UINT capacity = m_vertexCapacity;
+        while (capacity < m_vertices.size()) {
+            capacity *= 2;
+        }
+
+        CreateVertexBuffer(capacity);
+    }
+
+    m_verticesChanged = false;
+
+    if (m_vertices.empty()) {
+        return;
+    }
+
     D3D11_MAPPED_SUBRESOURCE mappedResource;
     ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
 
     m_dxContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-    memcpy(mappedResource.pData, m_vertices, m_verticeCount * sizeof(VERTEX));
+    memcpy(mappedResource.pData, m_vertices.data(), m_vertices.size() * sizeof(VERTEX));
     m_dxContext->Unmap(m_vertexBuffer.Get(), 0);
 }
 
@@ -192,7 +215,6 @@ bool CGame::Update(InputController^ controller) {
         vectrex_emulator_key(PL1_DOWN, true);
     }
 
-    m_verticeCount = 0;
     vectrex_emulator_frame();
     RemapVertexBuffer();
 
@@ -220,25 +242,30 @@ void CGame::Render() {
 
     m_dxContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
 
-    for (int i = 0; i < m_verticeCount /2; i=i+2) {
-        m_dxContext->Draw(2, i);
+    for (const STRIP& strip : m_strips) {
+        m_dxContext->Draw(strip.count, strip.first);
     }
 
     m_dxSwapChain->Present(1, 0);
 }
 
 void CGame::InitGraphics() {
+    CreateVertexBuffer(2048);
+}
+
+void CGame::CreateVertexBuffer(UINT capacity) {
     D3D11_BUFFER_DESC bd = { 0 };
-    bd.ByteWidth = sizeof(VERTEX) * 2048;
+    bd.ByteWidth = sizeof(VERTEX) * capacity;
     bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     bd.Usage = D3D11_USAGE_DYNAMIC;
     bd.MiscFlags = 0;
     bd.StructureByteStride = 0;
 
-    D3D11_SUBRESOURCE_DATA srd = { m_vertices, 0, 0 };
-
-    m_dxDevice->CreateBuffer(&bd, &srd, &m_vertexBuffer);
+    m_vertexBuffer.Reset();
+    m_dxDevice->CreateBuffer(&bd, nullptr, &m_vertexBuffer);
+    m_vertexCapacity = capacity;
+    m_verticesChanged = true;
 }
 
 void CGame::InitPipeline() {
@@ -260,16 +287,39 @@ void CGame::InitPipeline() {
     m_dxContext->IASetInputLayout(m_inputLayout.Get());
 }
 
-void CGame::AddLine(int x1, int y1, int x2, int y2, uint8_t color) {
-    if (m_verticeCount >= 2048) {
+static VERTEX ScreenToVertex(int x, int y) {
+    float vx = 1.0 - 1.0f / 310.0f * (float)x + 0.5;
+    float vy = 1.0 - 1.0f / 410.0f * (float)y - 0.25;
+
+    return { -1*vx, vy, 0.0f };
+}
+
+void CGame::SetDisplayList(const display_list_t* list) {
+    // keep the frame until the emulator renders the next one, a frame that
+    // did not change keeps the vertices that are already uploaded
+    if (list->unchanged) {
         return;
     }
 
-    float x = 1.0 - 1.0f / 310.0f * (float)x1 + 0.5;
-    float y = 1.0 - 1.0f / 410.0f * (float)y1 - 0.25;
-    m_vertices[m_verticeCount++] = { -1*x, y, 0.0f };
+    m_verticesChanged = true;
+    m_vertices.clear();
+    m_strips.clear();
+
+    for (long i = 0; i < list->count; i++) {
+        const int* line = &list->lines[i * 4];
 
-    x = 1.0-1.0f / 310 * (float)x2 + 0.5;
-    y = 1.0-1.0f / 410.0f * (float)y2 - 0.25;
-    m_vertices[m_verticeCount++] = { -1*x, y, 0.0f };
+        m_strips.push_back({ (int)m_vertices.size(), 2 });
+        m_vertices.push_back(ScreenToVertex(line[0], line[1]));
+        m_vertices.push_back(ScreenToVertex(line[2], line[3]));
+    }
+
+    for (long i = 0; i < list->strip_count; i++) {
+        const int* points = &list->points[list->strips[i].first * 2];
+
+        m_strips.push_back({ (int)m_vertices.size(), (int)list->strips[i].count });
+
+        for (long p = 0; p < list->strips[i].count; p++) {
+            m_vertices.push_back(ScreenToVertex(points[p * 2], points[p * 2 + 1]));
+        }
+    }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "InputController.h"
+#include "vec3x_emulator_types.hpp"
 #include <string>
 #include <vector>
 
@@ -14,16 +15,22 @@ struct VERTEX {
     float x, y, z;
 };
 
+// a line strip in the vertex buffer
+struct STRIP {
+    int first, count;
+};
+
 class CGame {
 public:
     void Initialize();
     bool Update(InputController^ controller);
     void Render();
 
-    void AddLine(int x1, int y1, int x2, int y2, uint8_t color);
+    void SetDisplayList(const display_list_t* list);
 
 private:
     void RemapVertexBuffer();
+    void CreateVertexBuffer(UINT capacity);
     void InitGraphics();
     void InitPipeline();
     void LoadGame();
@@ -39,8 +46,10 @@ private:
     ComPtr<ID3D11PixelShader> m_pixelShader;            // the pixel shader interface
     ComPtr<ID3D11InputLayout> m_inputLayout;            // the input layout interface
  
-    VERTEX m_vertices[2048] = { };
-    int m_verticeCount = 0;
+    std::vector<VERTEX> m_vertices;                     // last display list, as line strips
+    std::vector<STRIP> m_strips;
+    UINT m_vertexCapacity = 0;                          // size of the vertex buffer in vertices
+    bool m_verticesChanged = false;                     // m_vertices not uploaded yet
 
     std::vector<std::string> m_romList;
     int m_selectedRom = 0;
@@ -9,6 +9,30 @@
 #include "pch.h"
 #include "vec3x_emulator.hpp"
 
+#include <limits.h>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VEC3X_SSE2_AVAILABLE
+#endif
+
+#ifdef VEC3X_SSE2_AVAILABLE
+/* the division by the screen scale is a multiplication by its 16 bit
+ * reciprocal, which is at most one too small for any coordinate. one
+ * correction step then gives exactly the quotient of the scalar path.
+ * the remainder is below twice the scale, so it compares fine as a
+ * signed value as long as the scale is below 0x4000.
+ */
+
+static inline __m128i DivScale(__m128i v, __m128i recip, __m128i scale, __m128i limit) {
+    __m128i q = _mm_mulhi_epu16(v, recip);
+    __m128i r = _mm_sub_epi16(v, _mm_mullo_epi16(q, scale));
+
+    return _mm_sub_epi16(q, _mm_cmpgt_epi16(r, limit));
+}
+#endif
+
 #define EMU_TIMER 20
 #define USE_PIXEL_BUFFER 1
 
@@ -18,7 +42,7 @@ extern "C" {
     void audio_processor_start(void* audioclass) {}
     void audio_processor_stop(void) {}
 
-    void vectrex_add_line(int x1, int y1, int x2, int y2, uint8_t color);
+    void vectrex_display_list(const display_list_t* list);
     void vectrex_update_cpu_view(unsigned pc, unsigned usp, unsigned hsp, unsigned acc_a, unsigned acc_b, unsigned reg_x, unsigned reg_y, unsigned reg_dp, unsigned reg_cc, long vectors) {}
     unsigned vectrex_get_register(int reg);
 
@@ -28,36 +52,61 @@ extern "C" {
 Vec3XEmulator::Vec3XEmulator() : ic6809(this) {
 }
 
+Vec3XEmulator::~Vec3XEmulator() {
+    free(vectors_draw.x0);
+    free(vectors_erse.x0);
+    free(vector_hash);
+    free(strips);
+    free(strip_points);
+    free(render_screen);
+    free(render_added);
+    free(render_removed);
+    free(_intensityBuffer);
+    free(_phosphorBuffer);
+    free(_pixelBuffer);
+    free(raster_dirty);
+    free(stream_events);
+
+    RasterThreads(0);
+    free(raster_band_first);
+    free(raster_band_next);
+    free(raster_band_lines);
+}
+
 #pragma mark - Drawing
 
 void Vec3XEmulator::CreateBuffer(long width, long height) {
+    // the lines are drawn into one byte of intensity per pixel, with a one
+    // pixel border for DrawLineWu. the pixel buffer is only allocated when
+    // a consumer asks for a converted frame, see GetPixels
     if (_pixelBuffer != NULL) {
         free(_pixelBuffer);
         _pixelBuffer = NULL;
     }
+
+    free(_intensityBuffer);
+    free(_phosphorBuffer);
+    _phosphorBuffer = NULL;
+    free(raster_dirty);
+    raster_dirty = NULL;
     
     _bufferWidth = (int)width;
     _bufferHeight = (int)height;
+    _pixelBufferFormat = PIXEL_FORMAT_NONE;
+    _rasterValid = false;
+    _displayChanged = 0;
     
-    _pixelBuffer = (byte *)malloc(height * width * 4);
-}
-
-void Vec3XEmulator::FastClearBuffer(Uint8 color) {
-    memset(_pixelBuffer, color, _bufferWidth * _bufferHeight * 4);
+    _intensityBuffer = (Uint8 *)calloc((height + 2) * (width + 2), 1);
 }
 
 void Vec3XEmulator::ClearBuffer(Uint8 color) {
-    int offset = 0;
+    memset(_intensityBuffer, color, (_bufferWidth + 2) * (_bufferHeight + 2));
+}
 
-    for (int i = 0 ; i < _bufferWidth * _bufferHeight ; ++i) {
-        _pixelBuffer[offset] = color;
-        _pixelBuffer[offset+1] = color;
-        _pixelBuffer[offset+2] = color;
-        _pixelBuffer[offset+3] = 0;
-        
-        offset += 4;
+void Vec3XEmulator::ClearRect(const raster_rect_t* rect) {
+    for (int y = rect->top; y <= rect->bottom; y++) {
+        memset(_intensityBuffer + (y + 1) * (_bufferWidth + 2) + rect->left + 1, 0, rect->right - rect->left + 1);
     }
-
 }
 
 void Vec3XEmulator::SetPixel(int x, int y, Uint8 color) {
@@ -66,992 +115,2892 @@ void Vec3XEmulator::SetPixel(int x, int y, Uint8 color) {
     
     // Is the pixel actually visible?
     if (x >= 0 && x < width && y >= 0 && y < height) {
-        
-        int offset = (x + ((height - 1) - y) * width) * 4;
-        
-        // Use this to make the origin top-left instead of bottom-right.
-        offset = (x + y * width) * 4;
-        
-        _pixelBuffer[offset] = color;
-        _pixelBuffer[offset+1] = color;
-        _pixelBuffer[offset+2] = color;
-        _pixelBuffer[offset+3] = 255;
+        _intensityBuffer[(y + 1) * (width + 2) + x + 1] = color;
     }
 }
 
-void Vec3XEmulator::DrawLine(int x1, int y1, int x2, int y2, Uint8 color)  {
-    vectrex_add_line(x1, y1, x2, y2, color);
- 
-#ifdef USE_PIXEL_BUFFER
-    int dx = x2 - x1;
-    int dy = y2 - y1;
-    
-    // calculate steps required for generating pixels
-    int steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
-    
-    // calculate increment in x & y for each steps
-    float xInc = dx / (float) steps;
-    float yInc = dy / (float) steps;
-    
-    float x = x1;
-    float y = y1;
-    for (int i = 0; i <= steps; i++) {
-        SetPixel(x, y, color);
-        
-        x += xInc;
-        y += yInc;
+void Vec3XEmulator::TransformVectors(const vector_list_t* list, long count, int* screen) {
+    // scale the vectors to screen space, four ints x0, y0, x1, y1 per vector
+    long v = 0;
+
+#ifdef VEC3X_SSE2_AVAILABLE
+    if (_scaling >= 1 && _scaling < 0x4000) {
+        __m128i recip = _mm_set1_epi16((short)(_scaling == 1 ? 0xffff : 0x10000 / _scaling));
+        __m128i scale = _mm_set1_epi16((short)_scaling);
+        __m128i limit = _mm_set1_epi16((short)(_scaling - 1));
+        __m128i offset = _mm_setr_epi32((int)_xOffset, (int)_yOffset, (int)_xOffset, (int)_yOffset);
+        __m128i zero = _mm_setzero_si128();
+        __m128i q[4];
+        __m128i xy0, xy1, lines;
+
+        for (; v + 8 <= count; v += 8) {
+            q[0] = DivScale(_mm_loadu_si128((const __m128i *)&list->x0[v]), recip, scale, limit);
+            q[1] = DivScale(_mm_loadu_si128((const __m128i *)&list->y0[v]), recip, scale, limit);
+            q[2] = DivScale(_mm_loadu_si128((const __m128i *)&list->x1[v]), recip, scale, limit);
+            q[3] = DivScale(_mm_loadu_si128((const __m128i *)&list->y1[v]), recip, scale, limit);
+
+            /* interleave to x0 y0 x1 y1 per vector and widen to 32 bit */
+
+            xy0 = _mm_unpacklo_epi16(q[0], q[1]);
+            xy1 = _mm_unpacklo_epi16(q[2], q[3]);
+            lines = _mm_unpacklo_epi32(xy0, xy1);
+            _mm_storeu_si128((__m128i *)&screen[v * 4], _mm_add_epi32(_mm_unpacklo_epi16(lines, zero), offset));
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 4], _mm_add_epi32(_mm_unpackhi_epi16(lines, zero), offset));
+            lines = _mm_unpackhi_epi32(xy0, xy1);
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 8], _mm_add_epi32(_mm_unpacklo_epi16(lines, zero), offset));
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 12], _mm_add_epi32(_mm_unpackhi_epi16(lines, zero), offset));
+
+            xy0 = _mm_unpackhi_epi16(q[0], q[1]);
+            xy1 = _mm_unpackhi_epi16(q[2], q[3]);
+            lines = _mm_unpacklo_epi32(xy0, xy1);
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 16], _mm_add_epi32(_mm_unpacklo_epi16(lines, zero), offset));
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 20], _mm_add_epi32(_mm_unpackhi_epi16(lines, zero), offset));
+            lines = _mm_unpackhi_epi32(xy0, xy1);
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 24], _mm_add_epi32(_mm_unpacklo_epi16(lines, zero), offset));
+            _mm_storeu_si128((__m128i *)&screen[v * 4 + 28], _mm_add_epi32(_mm_unpackhi_epi16(lines, zero), offset));
+        }
     }
 #endif
+
+    for (; v < count; v++) {
+        screen[v * 4] = (int)(_xOffset + list->x0[v] / _scaling);
+        screen[v * 4 + 1] = (int)(_yOffset + list->y0[v] / _scaling);
+        screen[v * 4 + 2] = (int)(_xOffset + list->x1[v] / _scaling);
+        screen[v * 4 + 3] = (int)(_yOffset + list->y1[v] / _scaling);
+    }
 }
 
-void Vec3XEmulator::Render() {
-#ifdef USE_PIXEL_BUFFER
-    ClearBuffer(0);
+void Vec3XEmulator::TransformPoints(const vector_point_t* points, long count, int* screen) {
+    // scale strip points to screen space, two ints x, y per point
+    long p = 0;
+
+#ifdef VEC3X_SSE2_AVAILABLE
+    if (_scaling >= 1 && _scaling < 0x4000) {
+        __m128i recip = _mm_set1_epi16((short)(_scaling == 1 ? 0xffff : 0x10000 / _scaling));
+        __m128i scale = _mm_set1_epi16((short)_scaling);
+        __m128i limit = _mm_set1_epi16((short)(_scaling - 1));
+        __m128i offset = _mm_setr_epi32((int)_xOffset, (int)_yOffset, (int)_xOffset, (int)_yOffset);
+        __m128i zero = _mm_setzero_si128();
+        __m128i q;
+
+        for (; p + 4 <= count; p += 4) {
+            q = DivScale(_mm_loadu_si128((const __m128i *)&points[p]), recip, scale, limit);
+
+            _mm_storeu_si128((__m128i *)&screen[p * 2], _mm_add_epi32(_mm_unpacklo_epi16(q, zero), offset));
+            _mm_storeu_si128((__m128i *)&screen[p * 2 + 4], _mm_add_epi32(_mm_unpackhi_epi16(q, zero), offset));
+        }
+    }
 #endif
 
-    int v;
-    for(v = 0; v < vector_draw_cnt; v++){
-        Uint8 color = vectors_draw[v].color * 256 / VECTREX_COLORS;
-        
-        DrawLine((int)(_xOffset + vectors_draw[v].x0 / _scaling), (int)(_yOffset + vectors_draw[v].y0 / _scaling),
-                 (int)(_xOffset + vectors_draw[v].x1 / _scaling), (int)(_yOffset + vectors_draw[v].y1 / _scaling), color);
+    for (; p < count; p++) {
+        screen[p * 2] = (int)(_xOffset + points[p].x / _scaling);
+        screen[p * 2 + 1] = (int)(_yOffset + points[p].y / _scaling);
     }
 }
 
-#pragma mark - Internal emulation
+void Vec3XEmulator::DrawLine(int x1, int y1, int x2, int y2, Uint8 color, const raster_rect_t* clip) {
+    // bresenham line, clipped once against clip. the pixels inside are the
+    // same as if the whole line was drawn. overlapping lines keep the
+    // brighter pixel, so the result does not depend on the drawing order
+    long long a1, b1;           // start on the major and minor axis
+    long long n, dm;            // length along the major and minor axis
+    long long amin, amax, bmin, bmax;
+    long long ilo, ihi;         // range of major steps inside the buffer
+    long long klo, khi;         // range of minor offsets inside the buffer
+    long long first, last;
+    long long num, m, rem;
+    long astride, bstride;      // pixels to step along each axis
+    long pitch = _bufferWidth + 2;
+    int sa, sb;
+    bool xmajor;
+    Uint8 *pixel;
+
+    xmajor = abs(x2 - x1) >= abs(y2 - y1);
+
+    if (xmajor) {
+        a1 = x1; b1 = y1;
+        n = abs(x2 - x1); dm = abs(y2 - y1);
+        sa = x2 < x1 ? -1 : 1; sb = y2 < y1 ? -1 : 1;
+        amin = clip->left; amax = clip->right;
+        bmin = clip->top; bmax = clip->bottom;
+        astride = sa; bstride = sb * pitch;
+    } else {
+        a1 = y1; b1 = x1;
+        n = abs(y2 - y1); dm = abs(x2 - x1);
+        sa = y2 < y1 ? -1 : 1; sb = x2 < x1 ? -1 : 1;
+        amin = clip->top; amax = clip->bottom;
+        bmin = clip->left; bmax = clip->right;
+        astride = sa * pitch; bstride = sb;
+    }
 
-void Vec3XEmulator::Reset() {
-    unsigned r;
+    /* step i is at a1 + sa * i, b1 + sb * m(i) with the minor offset
+     * m(i) = floor((2 * i * dm + n) / (2 * n)), which never decreases.
+     */
 
-    // RAM
-    for (r = 0; r < 1024; r++) {
-        _ram[r] = r & 0xff;
+    ilo = sa > 0 ? amin - a1 : a1 - amax;
+    ihi = sa > 0 ? amax - a1 : a1 - amin;
+    klo = sb > 0 ? bmin - b1 : b1 - bmax;
+    khi = sb > 0 ? bmax - b1 : b1 - bmin;
+
+    first = ilo > 0 ? ilo : 0;
+    last = ihi < n ? ihi : n;
+
+    if (khi < 0 || first > last) {
+        return;
     }
 
-    for (r = 0; r < 16; r++) {
-        _soundRegisters[r] = 0;
-        ic8910.Write(r, 0);
+    if (dm == 0) {
+        if (klo > 0) {
+            return;
+        }
+    } else {
+        if (klo > 0) {
+            /* first step with m(i) >= klo */
+            num = (2 * n * klo - n + 2 * dm - 1) / (2 * dm);
+            first = num > first ? num : first;
+        }
+
+        /* last step with m(i) <= khi */
+        num = (2 * n * (khi + 1) - n - 1) / (2 * dm);
+        last = num < last ? num : last;
     }
 
-    // input buttons
-    _soundRegisters[14] = 0xff;
-    ic8910.Write(14, 0xff);
+    if (first > last) {
+        return;
+    }
 
-    _soundSelect = 0;
+    if (n == 0) {
+        m = 0;
+        rem = 0;
+    } else {
+        num = 2 * first * dm + n;
+        m = num / (2 * n);
+        rem = num % (2 * n);
+    }
 
-    via_ora = 0;
-    via_orb = 0;
-    via_ddra = 0;
-    via_ddrb = 0;
-    via_t1on = 0;
-    via_t1int = 0;
-    via_t1c = 0;
-    via_t1ll = 0;
-    via_t1lh = 0;
-    via_t1pb7 = 0x80;
-    via_t2on = 0;
-    via_t2int = 0;
-    via_t2c = 0;
-    via_t2ll = 0;
-    via_sr = 0;
-    via_srb = 8;
-    via_src = 0;
-    via_srclk = 0;
-    via_acr = 0;
-    via_pcr = 0;
-    via_ifr = 0;
-    via_ier = 0;
-    via_ca2 = 1;
-    via_cb2h = 1;
-    via_cb2s = 0;
+    if (xmajor) {
+        pixel = _intensityBuffer + pitch + 1 + (b1 + sb * m) * pitch + (a1 + sa * first);
+    } else {
+        pixel = _intensityBuffer + pitch + 1 + (a1 + sa * first) * pitch + (b1 + sb * m);
+    }
 
-    alg_rsh = 128;
-    alg_xsh = 128;
-    alg_ysh = 128;
-    alg_zsh = 0;
-    alg_jch0 = 128;
-    alg_jch1 = 128;
-    alg_jch2 = 128;
-    alg_jch3 = 128;
-    alg_jsh = 128;
+    for (last -= first; ; last--) {
+        if (*pixel < color) {
+            *pixel = color;
+        }
 
-    alg_compare = 0;
+        if (last == 0) {
+            break;
+        }
 
-    alg_dx = 0;
-    alg_dy = 0;
-    alg_curr_x = ALG_MAX_X / 2;
-    alg_curr_y = ALG_MAX_Y / 2;
+        pixel += astride;
+        rem += 2 * dm;
 
-    alg_vectoring = 0;
+        if (rem >= 2 * n) {
+            rem -= 2 * n;
+            pixel += bstride;
+        }
+    }
+}
 
-    vector_draw_cnt = 0;
-    vector_erse_cnt = 0;
-    vectors_draw = vectors_set;
-    vectors_erse = vectors_set + VECTOR_CNT;
+void Vec3XEmulator::DrawLineWu(int x1, int y1, int x2, int y2, Uint8 color, const raster_rect_t* clip) {
+    // xiaolin wu line, added with saturation to the intensity buffer inside
+    // clip. the minor axis position is kept in 32.32 fixed point and its
+    // fraction splits the intensity between the two pixels it falls between
+    long long a1, b1;           // start on the major and minor axis
+    long long n;                // length along the major axis
+    long long amin, amax, bmin, bmax;
+    long long b;
+    long long first, last;
+    long long pos, step;        // minor axis position and step, 32.32
+    long long lo, hi;
+    long pitch, astride, bstride;
+    unsigned weight;
+    unsigned value;
+    Uint8 *pixel;
+    int sa;
+    bool xmajor;
+
+    xmajor = abs(x2 - x1) >= abs(y2 - y1);
+    pitch = _bufferWidth + 2;
+
+    if (xmajor) {
+        a1 = x1; b1 = y1;
+        n = abs(x2 - x1);
+        sa = x2 < x1 ? -1 : 1;
+        step = n == 0 ? 0 : (y2 - y1) * 0x100000000LL / n;
+        amin = clip->left; amax = clip->right;
+        bmin = clip->top; bmax = clip->bottom;
+        astride = sa; bstride = pitch;
+    } else {
+        a1 = y1; b1 = x1;
+        n = abs(y2 - y1);
+        sa = y2 < y1 ? -1 : 1;
+        step = (x2 - x1) * 0x100000000LL / n;
+        amin = clip->top; amax = clip->bottom;
+        bmin = clip->left; bmax = clip->right;
+        astride = sa * pitch; bstride = 1;
+    }
 
-    fcycles = FCYCLES_INIT;
+    /* clip the major axis and the minor axis so that at least one of the
+     * two pixels is inside, the loop only checks the edge rows.
+     */
 
-    ic6809.Reset();
+    first = sa > 0 ? amin - a1 : a1 - amax;
+    last = sa > 0 ? amax - a1 : a1 - amin;
+
+    first = first > 0 ? first : 0;
+    last = last < n ? last : n;
+
+    pos = b1 * 0x100000000LL;
+    lo = (bmin - 1) * 0x100000000LL - pos;      // step * i reaching row bmin - 1
+    hi = (bmax + 1) * 0x100000000LL - 1 - pos;  // step * i still in row bmax
+
+    if (step > 0) {
+        first = DivCeil(lo, step) > first ? DivCeil(lo, step) : first;
+        last = DivFloor(hi, step) < last ? DivFloor(hi, step) : last;
+    } else if (step < 0) {
+        first = DivCeil(hi, step) > first ? DivCeil(hi, step) : first;
+        last = DivFloor(lo, step) < last ? DivFloor(lo, step) : last;
+    } else if (lo > 0 || hi < 0) {
+        return;
+    }
+
+    if (first > last) {
+        return;
+    }
+
+    pos += step * first;
+    pixel = _intensityBuffer + pitch + 1 + (a1 + sa * first) * astride * sa;
+
+    for (last -= first; ; last--) {
+        b = pos >> 32;
+        Uint8 *p = pixel + b * bstride;
+
+        weight = (unsigned) (pos >> 24) & 0xff;
+
+        if (b >= bmin) {
+            value = p[0] + ((color * (weight ^ 0xff)) >> 8);
+            p[0] = (Uint8) (value > 0xff ? 0xff : value);
+        }
+
+        if (b < bmax) {
+            value = p[bstride] + ((color * weight) >> 8);
+            p[bstride] = (Uint8) (value > 0xff ? 0xff : value);
+        }
+
+        if (last == 0) {
+            break;
+        }
+
+        pixel += astride;
+        pos += step;
+    }
 }
 
-void Vec3XEmulator::Emulate(long cycles) {
-    unsigned c, icycles;
+void Vec3XEmulator::ConvertPixels(int format) {
+    // expand the intensity or phosphor buffer into the pixel buffer, leaving
+    // out the border. the grey rgba and bgra are the same bytes, pixels that
+    // were not lit get alpha 0 like the cleared rgba buffer used to have
+    const Uint8 *image = _phosphorDecay != 0 && _phosphorBuffer != NULL ? _phosphorBuffer : _intensityBuffer;
+    const Uint8 *src;
+    Uint8 *dst;
+    Uint16 *dst16;
+    int x, y;
+
+    for (y = 0; y < _bufferHeight; y++) {
+        src = image + (y + 1) * (_bufferWidth + 2) + 1;
+
+        if (format == PIXEL_FORMAT_INTENSITY) {
+            memcpy(_pixelBuffer + y * _bufferWidth, src, _bufferWidth);
+            continue;
+        }
+
+        x = 0;
 
-    while (cycles > 0) {
-        icycles = ic6809.Step(via_ifr & 0x80, 0);
+        if (format == PIXEL_FORMAT_RGB565) {
+            dst16 = (Uint16 *)_pixelBuffer + y * _bufferWidth;
 
-        for (c = 0; c < icycles; c++) {
-            ViaSstep0();
-            AlgSstep();
-            ViaSstep1();
+#ifdef VEC3X_SSE2_AVAILABLE
+            __m128i zero = _mm_setzero_si128();
+            __m128i rmask = _mm_set1_epi16(0xf8);
+            __m128i gmask = _mm_set1_epi16(0xfc);
+
+            for (; x + 16 <= _bufferWidth; x += 16) {
+                __m128i c = _mm_loadu_si128((const __m128i *)&src[x]);
+                __m128i lo = _mm_unpacklo_epi8(c, zero);
+                __m128i hi = _mm_unpackhi_epi8(c, zero);
+
+                lo = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(lo, rmask), 8),
+                                               _mm_slli_epi16(_mm_and_si128(lo, gmask), 3)),
+                                  _mm_srli_epi16(lo, 3));
+                hi = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(hi, rmask), 8),
+                                               _mm_slli_epi16(_mm_and_si128(hi, gmask), 3)),
+                                  _mm_srli_epi16(hi, 3));
+
+                _mm_storeu_si128((__m128i *)&dst16[x], lo);
+                _mm_storeu_si128((__m128i *)&dst16[x + 8], hi);
+            }
+#endif
+
+            for (; x < _bufferWidth; x++) {
+                dst16[x] = (Uint16)(((src[x] & 0xf8) << 8) | ((src[x] & 0xfc) << 3) | (src[x] >> 3));
+            }
+
+            continue;
         }
 
-        cycles -= (long) icycles;
+        dst = _pixelBuffer + y * _bufferWidth * 4;
 
-        fcycles -= (long) icycles;
+#ifdef VEC3X_SSE2_AVAILABLE
+        __m128i zero = _mm_setzero_si128();
+        __m128i ones = _mm_set1_epi8(-1);
 
-        if (fcycles < 0) {
-            vector_t *tmp;
+        for (; x + 16 <= _bufferWidth; x += 16) {
+            __m128i c = _mm_loadu_si128((const __m128i *)&src[x]);
+            __m128i a = _mm_xor_si128(_mm_cmpeq_epi8(c, zero), ones);
+            __m128i cc = _mm_unpacklo_epi8(c, c);
+            __m128i ca = _mm_unpacklo_epi8(c, a);
 
-            fcycles += FCYCLES_INIT;
-            Render();
+            _mm_storeu_si128((__m128i *)&dst[x * 4], _mm_unpacklo_epi16(cc, ca));
+            _mm_storeu_si128((__m128i *)&dst[x * 4 + 16], _mm_unpackhi_epi16(cc, ca));
 
-            // everything that was drawn during this pass now now enters
-            vector_erse_cnt = vector_draw_cnt;
-            vector_draw_cnt = 0;
+            cc = _mm_unpackhi_epi8(c, c);
+            ca = _mm_unpackhi_epi8(c, a);
 
-            tmp = vectors_erse;
-            vectors_erse = vectors_draw;
-            vectors_draw = tmp;
+            _mm_storeu_si128((__m128i *)&dst[x * 4 + 32], _mm_unpacklo_epi16(cc, ca));
+            _mm_storeu_si128((__m128i *)&dst[x * 4 + 48], _mm_unpackhi_epi16(cc, ca));
+        }
+#endif
+
+        for (; x < _bufferWidth; x++) {
+            dst[x * 4] = src[x];
+            dst[x * 4 + 1] = src[x];
+            dst[x * 4 + 2] = src[x];
+            dst[x * 4 + 3] = src[x] != 0 ? 255 : 0;
         }
     }
 }
 
-#pragma mark - Load file
-
-void Vec3XEmulator::LoadFile(const char* romfile, const char* romName, const char* cartfile, const char* cartName) {
-    FILE *fp;
-    char msg[255];
-    errno_t error;
+void Vec3XEmulator::PhosphorDecay() {
+    // fade the phosphor buffer by _phosphorDecay / 256 and add the beam of
+    // this refresh with saturation. integer math only, so a recording comes
+    // out the same on every run and host
+    long size = (_bufferWidth + 2) * (_bufferHeight + 2);
+    unsigned value;
+    long i = 0;
+
+#ifdef VEC3X_SSE2_AVAILABLE
+    __m128i zero = _mm_setzero_si128();
+    __m128i decay = _mm_set1_epi16((short) _phosphorDecay);
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i p = _mm_loadu_si128((const __m128i *)&_phosphorBuffer[i]);
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), decay), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), decay), 8);
+
+        p = _mm_adds_epu8(_mm_packus_epi16(lo, hi), _mm_loadu_si128((const __m128i *)&_intensityBuffer[i]));
+        _mm_storeu_si128((__m128i *)&_phosphorBuffer[i], p);
+    }
+#endif
 
-    error = fopen_s(&fp, romfile, "rb");
-    if (error != 0) {
-        platform_print("ERROR LOADING ROMFILE (1)");
-        return;
+    for (; i < size; i++) {
+        value = ((_phosphorBuffer[i] * _phosphorDecay) >> 8) + _intensityBuffer[i];
+        _phosphorBuffer[i] = (Uint8) (value > 0xff ? 0xff : value);
     }
+}
 
-    if (fread(_rom, 1, sizeof (_rom), fp) != sizeof (_rom)) {
-        platform_print("ERROR LOADING ROMFILE (2)");
-        return;
+const byte* Vec3XEmulator::GetPixels(int format) {
+    // the last rendered frame in the requested format. the conversion runs
+    // at most once per frame, asking again for the same format is free
+    if (format <= PIXEL_FORMAT_NONE || format > PIXEL_FORMAT_RGB565 || _intensityBuffer == NULL) {
+        return NULL;
     }
-    
-    fclose(fp);
 
-    sprintf_s(msg, "Rom file loaded: %s", romName);
-    platform_print(msg);
-    
-    memset(_cartridge, 0, sizeof (_cartridge));
-    if (cartfile) {
-        error = fopen_s(&fp, cartfile, "rb");
-        if (error != 0) {
-            platform_print("ERROR LOADING GAMEFILE (1)");
-            return;
+    if (_pixelBuffer == NULL) {
+        /* big enough for every format */
+        _pixelBuffer = (byte *)malloc(_bufferWidth * _bufferHeight * 4);
+
+        if (_pixelBuffer == NULL) {
+            return NULL;
         }
+    }
 
-        fread(_cartridge, 1, sizeof (_cartridge), fp);
-        fclose(fp);
+    if (_pixelBufferFormat != format || _pixelBufferFrame != _imageFrame) {
+        ConvertPixels(format);
+        _pixelBufferFormat = format;
+        _pixelBufferFrame = _imageFrame;
+    }
 
-        sprintf_s(msg, "Cartridge file loaded: %s", cartName);
-        platform_print(msg);
+    return _pixelBuffer;
+}
+
+void Vec3XEmulator::DrawLineDDA(int x1, int y1, int x2, int y2, Uint8 color) {
+    // the original floating point line, kept as the reference of RasterBenchmark
+    int dx = x2 - x1;
+    int dy = y2 - y1;
+    
+    // calculate steps required for generating pixels
+    int steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+    
+    // calculate increment in x & y for each steps
+    float xInc = dx / (float) steps;
+    float yInc = dy / (float) steps;
+    
+    float x = x1;
+    float y = y1;
+    for (int i = 0; i <= steps; i++) {
+        SetPixel(x, y, color);
+        
+        x += xInc;
+        y += yInc;
     }
 }
 
-#pragma mark - Screen resizing
+void Vec3XEmulator::RasterBenchmark() {
+    // time the line rasterizers on the last rendered frame at 1080p and 4k,
+    // and the conversion of the intensity buffer to rgba and rgb565
+    static const int sizes[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    enum { RUNS = 20 };
+    byte *pixelBuffer = _pixelBuffer;
+    Uint8 *intensityBuffer = _intensityBuffer;
+    Uint8 *rasterDirty = raster_dirty;
+    Uint8 *phosphorBuffer = _phosphorBuffer;
+    int bufferWidth = _bufferWidth;
+    int bufferHeight = _bufferHeight;
+    long scaling = _scaling;
+    long xOffset = _xOffset;
+    long yOffset = _yOffset;
+    raster_rect_t full;
+    double dda, bresenham, wu, rgba, rgb565, phosphor;
+    char msg[255];
+    long i;
+    int size, run;
 
-void Vec3XEmulator::ResizeScreen(int width, int height) {
-    long sclx, scly;
+    if (vector_erse_cnt > render_size && !RenderGrow(vector_erse_cnt)) {
+        return;
+    }
 
-    long screenx = width;
-    long screeny = height;
-    
-    CreateBuffer(screenx, screeny);
+    for (size = 0; size < 2; size++) {
+        _pixelBuffer = NULL;
+        _intensityBuffer = NULL;
+        raster_dirty = NULL;
+        _phosphorBuffer = NULL;
+        ResizeScreen(sizes[size][0], sizes[size][1]);
+
+        _pixelBuffer = (byte *)malloc(_bufferWidth * _bufferHeight * 4);
+        _phosphorBuffer = (Uint8 *)calloc((_bufferWidth + 2) * (_bufferHeight + 2), 1);
+
+        if (_pixelBuffer == NULL || _intensityBuffer == NULL || _phosphorBuffer == NULL) {
+            free(_pixelBuffer);
+            free(_intensityBuffer);
+            free(_phosphorBuffer);
+            break;
+        }
 
-    sclx = ALG_MAX_X / width;
-    scly = ALG_MAX_Y / height;
+        full.left = 0;
+        full.top = 0;
+        full.right = _bufferWidth - 1;
+        full.bottom = _bufferHeight - 1;
 
-    _scaling = sclx > scly ? sclx : scly;
+        TransformVectors(&vectors_erse, vector_erse_cnt, render_screen);
 
-    _xOffset = (screenx - ALG_MAX_X / _scaling) / 2;
-    _yOffset = (screeny - ALG_MAX_Y / _scaling) / 2;
-}
+        auto start = std::chrono::steady_clock::now();
 
-#pragma mark - Key events
+        for (run = 0; run < RUNS; run++) {
+            for (i = 0; i < vector_erse_cnt; i++) {
+                DrawLineDDA(render_screen[i * 4], render_screen[i * 4 + 1], render_screen[i * 4 + 2], render_screen[i * 4 + 3], 0xff);
+            }
+        }
 
-void Vec3XEmulator::Key(int vk, int pressed) {
-    if (pressed) {
-        switch (vk) {
-            case PL1_LEFT:
-                _soundRegisters[14] &= ~0x01;
-                break;
-            case PL1_RIGHT:
-                _soundRegisters[14] &= ~0x02;
-                break;
-            case PL1_UP:
-                _soundRegisters[14] &= ~0x04;
-                break;
-            case PL1_DOWN:
-                _soundRegisters[14] &= ~0x08;
-                break;
-                
-            case PL2_LEFT:
-                alg_jch0 = 0x00;
-                break;
-            case PL2_RIGHT:
-                alg_jch0 = 0xff;
-                break;
-            case PL2_UP:
-                alg_jch1 = 0xff;
-                break;
-            case PL2_DOWN:
-                alg_jch1 = 0x00;
-                break;
+        auto middle = std::chrono::steady_clock::now();
+
+        for (run = 0; run < RUNS; run++) {
+            for (i = 0; i < vector_erse_cnt; i++) {
+                DrawLine(render_screen[i * 4], render_screen[i * 4 + 1], render_screen[i * 4 + 2], render_screen[i * 4 + 3], 0xff, &full);
+            }
         }
-    }
-    else {
-        switch (vk) {
-            case PL1_LEFT:
-                _soundRegisters[14] |= 0x01;
-                break;
-            case PL1_RIGHT:
-                _soundRegisters[14] |= 0x02;
-                break;
-            case PL1_UP:
-                _soundRegisters[14] |= 0x04;
-                break;
-            case PL1_DOWN:
-                _soundRegisters[14] |= 0x08;
-                break;
-                
-            case PL2_LEFT:
-                alg_jch0 = 0x80;
-                break;
-            case PL2_RIGHT:
-                alg_jch0 = 0x80;
-                break;
-            case PL2_UP:
-                alg_jch1 = 0x80;
-                break;
-            case PL2_DOWN:
-                alg_jch1 = 0x80;
-                break;
+
+        auto last = std::chrono::steady_clock::now();
+
+        for (run = 0; run < RUNS; run++) {
+            for (i = 0; i < vector_erse_cnt; i++) {
+                DrawLineWu(render_screen[i * 4], render_screen[i * 4 + 1], render_screen[i * 4 + 2], render_screen[i * 4 + 3], 0xff, &full);
+            }
         }
-    }
-}
 
-void Vec3XEmulator::Init(int width, int height) {
-    ResizeScreen(width, height);
-    _paused = false;
-}
+        auto wuEnd = std::chrono::steady_clock::now();
 
-void Vec3XEmulator::Start(const char* romfile, const char* romName, const char* cartfile, const char* cartName) {
-    LoadFile(romfile, romName, cartfile, cartName);
+        for (run = 0; run < RUNS; run++) {
+            ConvertPixels(PIXEL_FORMAT_RGBA);
+        }
 
-    ic8910.Start(&_soundRegisters[0]);
-    audio_processor_start(&ic8910);
+        auto rgbaEnd = std::chrono::steady_clock::now();
 
-    Reset();
-    
-    _isInitialised = true;
-}
+        for (run = 0; run < RUNS; run++) {
+            ConvertPixels(PIXEL_FORMAT_RGB565);
+        }
 
-void Vec3XEmulator::Frame() {
-    if (!_isInitialised) {
-        return;
+        auto rgb565End = std::chrono::steady_clock::now();
+
+        for (run = 0; run < RUNS; run++) {
+            PhosphorDecay();
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        dda = std::chrono::duration<double, std::milli>(middle - start).count() / RUNS;
+        bresenham = std::chrono::duration<double, std::milli>(last - middle).count() / RUNS;
+        wu = std::chrono::duration<double, std::milli>(wuEnd - last).count() / RUNS;
+        rgba = std::chrono::duration<double, std::milli>(rgbaEnd - wuEnd).count() / RUNS;
+        rgb565 = std::chrono::duration<double, std::milli>(rgb565End - rgbaEnd).count() / RUNS;
+        phosphor = std::chrono::duration<double, std::milli>(end - rgb565End).count() / RUNS;
+
+        sprintf_s(msg, "raster %dx%d, %ld lines: dda %.3f ms, bresenham %.3f ms, wu %.3f ms, rgba %.3f ms, rgb565 %.3f ms, phosphor %.3f ms\n",
+                 sizes[size][0], sizes[size][1], vector_erse_cnt, dda, bresenham, wu, rgba, rgb565, phosphor);
+        platform_print(msg);
+
+        free(_pixelBuffer);
+        free(_intensityBuffer);
+        free(_phosphorBuffer);
     }
-    
-    if (_paused) {
+
+    _pixelBuffer = pixelBuffer;
+    _intensityBuffer = intensityBuffer;
+    raster_dirty = rasterDirty;
+    _phosphorBuffer = phosphorBuffer;
+    _pixelBufferFormat = PIXEL_FORMAT_NONE;
+    _rasterValid = false;
+    _bufferWidth = bufferWidth;
+    _bufferHeight = bufferHeight;
+    _scaling = scaling;
+    _xOffset = xOffset;
+    _yOffset = yOffset;
+}
+
+void Vec3XEmulator::RasterLine(const int* screen, Uint8 color, const raster_rect_t* clip) {
+    // draw one line unless it misses clip. the box is one pixel larger to
+    // the right and bottom for the second pixel of DrawLineWu
+    if ((screen[0] < screen[2] ? screen[0] : screen[2]) > clip->right ||
+        (screen[0] > screen[2] ? screen[0] : screen[2]) + 1 < clip->left ||
+        (screen[1] < screen[3] ? screen[1] : screen[3]) > clip->bottom ||
+        (screen[1] > screen[3] ? screen[1] : screen[3]) + 1 < clip->top) {
         return;
     }
 
-    Emulate((VECTREX_MHZ / 1000) * EMU_TIMER);
-    vectrex_render_frame(_pixelBuffer);
-    
-    if (_liveUpdate) {
-        vectrex_update_cpu_view(vectrex_get_register(VECTREX_PC), vectrex_get_register(VECTREX_USP), vectrex_get_register(VECTREX_HSP), vectrex_get_register(VECTREX_ACC_A), vectrex_get_register(VECTREX_ACC_B), vectrex_get_register(VECTREX_REG_X), vectrex_get_register(VECTREX_REG_Y), vectrex_get_register(VECTREX_REG_DP), vectrex_get_register(VECTREX_REG_CC), vector_draw_cnt);
+    if (_antialias) {
+        DrawLineWu(screen[0], screen[1], screen[2], screen[3], color, clip);
+    } else {
+        DrawLine(screen[0], screen[1], screen[2], screen[3], color, clip);
     }
 }
 
-void Vec3XEmulator::Stop() {
-    ic8910.Stop();
-    audio_processor_stop();
-    _isInitialised = 0;
+void Vec3XEmulator::RasterList(const display_list_t* list, const raster_rect_t* clip) {
+    // draw the lines or strips of a display list into clip
+    const int* screen;
+    long i, p;
+
+    for (i = 0; i < list->count; i++) {
+        RasterLine(&list->lines[i * 4], list->colors[i] * 256 / VECTREX_COLORS, clip);
+    }
+
+    for (i = 0; i < list->strip_count; i++) {
+        screen = &list->points[list->strips[i].first * 2];
+
+        for (p = 1; p < list->strips[i].count; p++, screen += 2) {
+            RasterLine(screen, list->strips[i].color * 256 / VECTREX_COLORS, clip);
+        }
+    }
 }
 
-void Vec3XEmulator::Pause(void) {
-    _paused = 1;
+long Vec3XEmulator::RasterMark(const vector_list_t* list, long v, long cols) {
+    // mark the tiles under the screen box of a vector, returns how many
+    // were not marked before
+    long x0, y0, x1, y1;
+    long left, top, right, bottom;
+    long tx, ty, marked;
+
+    x0 = _xOffset + list->x0[v] / _scaling;
+    y0 = _yOffset + list->y0[v] / _scaling;
+    x1 = _xOffset + list->x1[v] / _scaling;
+    y1 = _yOffset + list->y1[v] / _scaling;
+
+    left = x0 < x1 ? x0 : x1;
+    right = (x0 > x1 ? x0 : x1) + 1;
+    top = y0 < y1 ? y0 : y1;
+    bottom = (y0 > y1 ? y0 : y1) + 1;
+
+    left = left > 0 ? left : 0;
+    top = top > 0 ? top : 0;
+    right = right < _bufferWidth - 1 ? right : _bufferWidth - 1;
+    bottom = bottom < _bufferHeight - 1 ? bottom : _bufferHeight - 1;
+
+    if (left > right || top > bottom) {
+        return 0;
+    }
+
+    marked = 0;
+
+    for (ty = top >> RASTER_TILE_BITS; ty <= bottom >> RASTER_TILE_BITS; ty++) {
+        for (tx = left >> RASTER_TILE_BITS; tx <= right >> RASTER_TILE_BITS; tx++) {
+            if (raster_dirty[ty * cols + tx] == 0) {
+                raster_dirty[ty * cols + tx] = 1;
+                marked++;
+            }
+        }
+    }
+
+    return marked;
 }
 
-void Vec3XEmulator::Resume(void) {
-    _paused = 0;
+bool Vec3XEmulator::RasterDirty() {
+    // find the tiles that changed since the last frame, under the vectors
+    // that left the screen and those that are new or changed color, and
+    // merge them into raster_rects. false if a full redraw is cheaper
+    raster_rect_t rect;
+    long cols, rows;
+    long dirty, limit;
+    long i, r, tx, ty, end;
+
+    cols = (_bufferWidth + RASTER_TILE_SIZE - 1) >> RASTER_TILE_BITS;
+    rows = (_bufferHeight + RASTER_TILE_SIZE - 1) >> RASTER_TILE_BITS;
+
+    if (raster_dirty == NULL) {
+        raster_dirty = (Uint8 *) malloc(cols * rows);
+
+        if (raster_dirty == NULL) {
+            return false;
+        }
+    }
+
+    memset(raster_dirty, 0, cols * rows);
+
+    /* past half of the screen the tiles are not worth it */
+
+    dirty = 0;
+    limit = cols * rows / 2;
+
+    for (i = 0; i < vector_erse_cnt && dirty <= limit; i++) {
+        if (vectors_erse.color[i] != VECTREX_COLORS) {
+            dirty += RasterMark(&vectors_erse, i, cols);
+        }
+    }
+
+    for (i = 0; i < vector_draw_cnt && dirty <= limit; i++) {
+        if (!vectors_draw.kept[i]) {
+            dirty += RasterMark(&vectors_draw, i, cols);
+        }
+    }
+
+    if (dirty > limit) {
+        return false;
+    }
+
+    /* runs of tiles in a row become rectangles, which grow downwards while
+     * the next row has a run with the same columns.
+     */
+
+    raster_rect_cnt = 0;
+
+    for (ty = 0; ty < rows; ty++) {
+        for (tx = 0; tx < cols; tx = end + 1) {
+            end = tx;
+
+            if (raster_dirty[ty * cols + tx] == 0) {
+                continue;
+            }
+
+            while (end + 1 < cols && raster_dirty[ty * cols + end + 1] != 0) {
+                end++;
+            }
+
+            rect.left = (int) (tx << RASTER_TILE_BITS);
+            rect.top = (int) (ty << RASTER_TILE_BITS);
+            rect.right = (int) ((end + 1) << RASTER_TILE_BITS) - 1;
+            rect.bottom = rect.top + RASTER_TILE_SIZE - 1;
+
+            rect.right = rect.right < _bufferWidth - 1 ? rect.right : _bufferWidth - 1;
+            rect.bottom = rect.bottom < _bufferHeight - 1 ? rect.bottom : _bufferHeight - 1;
+
+            for (r = 0; r < raster_rect_cnt; r++) {
+                if (raster_rects[r].left == rect.left && raster_rects[r].right == rect.right && raster_rects[r].bottom + 1 == rect.top) {
+                    break;
+                }
+            }
+
+            if (r < raster_rect_cnt) {
+                raster_rects[r].bottom = rect.bottom;
+            } else if (raster_rect_cnt < RASTER_RECTS_MAX) {
+                raster_rects[raster_rect_cnt++] = rect;
+            } else {
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
-void Vec3XEmulator::Command(int command, int parameter) {
-    switch (command) {
-        case DEBUG_LIVE_UPDATE:
-            _liveUpdate = !_liveUpdate;
-            break;
+void Vec3XEmulator::RasterThreads(int count) {
+    // start count - 1 workers for RasterParallel, the emulation thread is
+    // the last one. one or less turns the parallel raster off
+    size_t i;
+
+    if (raster_threads.size() > 0) {
+        {
+            std::lock_guard<std::mutex> lock(raster_lock);
+            raster_quit = true;
+        }
+
+        raster_wake.notify_all();
+
+        for (i = 0; i < raster_threads.size(); i++) {
+            raster_threads[i].join();
+        }
+
+        raster_threads.clear();
+        raster_quit = false;
+    }
+
+    count = count < RASTER_THREADS_MAX ? count : RASTER_THREADS_MAX;
+
+    for (i = 1; i < (size_t) (count > 0 ? count : 0); i++) {
+        raster_threads.push_back(std::thread(&Vec3XEmulator::RasterWorker, this, raster_gen));
     }
 }
 
-#pragma mark - Internal bus handling
+void Vec3XEmulator::RasterWorker(unsigned gen) {
+    // body of a raster thread, draws bands whenever raster_gen moves on
+    std::unique_lock<std::mutex> lock(raster_lock);
 
-void Vec3XEmulator::SndUpdate() {
-    switch (via_orb & 0x18) {
-    case 0x00:
-        /* the sound chip is disabled */
-        break;
-    case 0x08:
-        /* the sound chip is sending data */
-        break;
-    case 0x10:
-        /* the sound chip is recieving data */
+    for (;;) {
+        raster_wake.wait(lock, [&] { return raster_quit || raster_gen != gen; });
 
-        if (_soundSelect != 14) {
-            _soundRegisters[_soundSelect] = via_ora;
-            ic8910.Write(_soundSelect, via_ora);
+        if (raster_quit) {
+            return;
         }
 
-        break;
-    case 0x18:
-        /* the sound chip is latching an address */
+        gen = raster_gen;
 
-        if ((via_ora & 0xf0) == 0x00) {
-            _soundSelect = via_ora & 0x0f;
+        lock.unlock();
+        RasterBands();
+        lock.lock();
+
+        if (--raster_busy == 0) {
+            raster_done.notify_one();
         }
+    }
+}
 
-        break;
+void Vec3XEmulator::RasterBinLine(const int* screen, Uint8 color, bool fill) {
+    // count a line in every band its box reaches, or store it there
+    long top, bottom, b;
+
+    if ((screen[0] < screen[2] ? screen[0] : screen[2]) > _bufferWidth - 1 ||
+        (screen[0] > screen[2] ? screen[0] : screen[2]) + 1 < 0) {
+        return;
+    }
+
+    top = screen[1] < screen[3] ? screen[1] : screen[3];
+    bottom = (screen[1] > screen[3] ? screen[1] : screen[3]) + 1;
+
+    top = top > 0 ? top : 0;
+    bottom = bottom < _bufferHeight - 1 ? bottom : _bufferHeight - 1;
+
+    for (b = top >> RASTER_BAND_BITS; b <= bottom >> RASTER_BAND_BITS; b++) {
+        if (fill) {
+            raster_band_lines[raster_band_next[b]].screen = screen;
+            raster_band_lines[raster_band_next[b]].color = color;
+            raster_band_next[b]++;
+        } else {
+            raster_band_first[b + 1]++;
+        }
     }
 }
 
-void Vec3XEmulator::AlgUpdate() {
-    // update the various analog values when orb is written.
-    switch (via_orb & 0x06) {
-    case 0x00:
-        alg_jsh = alg_jch0;
+bool Vec3XEmulator::RasterBin(const display_list_t* list) {
+    // sort the lines of a display list into bands of RASTER_BAND_SIZE rows,
+    // keeping the list order within every band
+    const int *screen;
+    long *nfirst, *nnext;
+    raster_line_t *nlines;
+    long i, p, total;
+    int pass;
 
-        if ((via_orb & 0x01) == 0x00) {
-            /* demultiplexor is on */
-            alg_ysh = alg_xsh;
+    raster_band_cnt = (_bufferHeight + RASTER_BAND_SIZE - 1) >> RASTER_BAND_BITS;
+
+    if (raster_band_cnt > raster_band_size) {
+        nfirst = (long *) realloc(raster_band_first, (raster_band_cnt + 1) * sizeof (long));
+
+        if (nfirst != NULL) {
+            raster_band_first = nfirst;
         }
 
-        break;
-    case 0x02:
-        alg_jsh = alg_jch1;
+        nnext = (long *) realloc(raster_band_next, raster_band_cnt * sizeof (long));
 
-        if ((via_orb & 0x01) == 0x00) {
-            /* demultiplexor is on */
-            alg_rsh = alg_xsh;
+        if (nnext != NULL) {
+            raster_band_next = nnext;
         }
 
-        break;
-    case 0x04:
-        alg_jsh = alg_jch2;
+        if (nfirst == NULL || nnext == NULL) {
+            return false;
+        }
 
-        if ((via_orb & 0x01) == 0x00) {
-            /* demultiplexor is on */
+        raster_band_size = raster_band_cnt;
+    }
 
-            if (alg_xsh > 0x80) {
-                alg_zsh = alg_xsh - 0x80;
-            } else {
-                alg_zsh = 0;
+    memset(raster_band_first, 0, (raster_band_cnt + 1) * sizeof (long));
+
+    /* count the lines per band first, then store them at their offsets */
+
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            for (i = 0; i < raster_band_cnt; i++) {
+                raster_band_first[i + 1] += raster_band_first[i];
+                raster_band_next[i] = raster_band_first[i];
+            }
+
+            total = raster_band_first[raster_band_cnt];
+
+            if (total > raster_line_size) {
+                nlines = (raster_line_t *) realloc(raster_band_lines, total * sizeof (raster_line_t));
+
+                if (nlines == NULL) {
+                    return false;
+                }
+
+                raster_band_lines = nlines;
+                raster_line_size = total;
             }
         }
 
-        break;
-    case 0x06:
-        /* sound output line */
-        alg_jsh = alg_jch3;
-        break;
-    }
+        for (i = 0; i < list->count; i++) {
+            RasterBinLine(&list->lines[i * 4], list->colors[i] * 256 / VECTREX_COLORS, pass == 1);
+        }
 
-    /* compare the current joystick direction with a reference */
+        for (i = 0; i < list->strip_count; i++) {
+            screen = &list->points[list->strips[i].first * 2];
 
-    if (alg_jsh > alg_xsh) {
-        alg_compare = 0x20;
-    } else {
-        alg_compare = 0;
+            for (p = 1; p < list->strips[i].count; p++, screen += 2) {
+                RasterBinLine(screen, list->strips[i].color * 256 / VECTREX_COLORS, pass == 1);
+            }
+        }
     }
 
-    /* compute the new "deltas" */
-
-    alg_dx = (long) alg_xsh - (long) alg_rsh;
-    alg_dy = (long) alg_rsh - (long) alg_ysh;
+    return true;
 }
 
-void Vec3XEmulator::IntUpdate() {
-    // update IRQ and bit-7 of the ifr register after making an adjustment to ifr
-    if ((via_ifr & 0x7f) & (via_ier & 0x7f)) {
-        via_ifr |= 0x80;
+void Vec3XEmulator::RasterBands() {
+    // clear and draw bands until none are left, run by every raster thread
+    raster_rect_t band;
+    long b, i;
+
+    while ((b = raster_band_job++) < raster_band_cnt) {
+        band.left = 0;
+        band.top = (int) (b << RASTER_BAND_BITS);
+        band.right = _bufferWidth - 1;
+        band.bottom = band.top + RASTER_BAND_SIZE - 1;
+        band.bottom = band.bottom < _bufferHeight - 1 ? band.bottom : _bufferHeight - 1;
+
+        ClearRect(&band);
+
+        for (i = raster_band_first[b]; i < raster_band_first[b + 1]; i++) {
+            RasterLine(raster_band_lines[i].screen, raster_band_lines[i].color, &band);
+        }
     }
-    else {
+}
+
+void Vec3XEmulator::RasterParallel(const display_list_t* list) {
+    // full redraw shared by the workers and this thread. a band only holds
+    // its own pixels and gets the same lines in the same order whichever
+    // thread draws it, so the frame is the same as drawn by RasterList
+    raster_rect_t full;
+
+    if (!RasterBin(list)) {
+        full.left = 0;
+        full.top = 0;
+        full.right = _bufferWidth - 1;
+        full.bottom = _bufferHeight - 1;
+
+        ClearBuffer(0);
+        RasterList(list, &full);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(raster_lock);
+        raster_band_job = 0;
+        raster_busy = (int) raster_threads.size();
+        raster_gen++;
+    }
+
+    raster_wake.notify_all();
+    RasterBands();
+
+    std::unique_lock<std::mutex> lock(raster_lock);
+    raster_done.wait(lock, [&] { return raster_busy == 0; });
+}
+
+unsigned long long Vec3XEmulator::VectorListHash(const vector_list_t* list, long count) {
+    // multiplicative hash over the end points and colors, in list order.
+    // merged and plain frames never hash the same
+    unsigned long long h;
+    unsigned long long key;
+    long v;
+
+    h = _mergeVectors ? VECTOR_HASH_MUL : 0;
+
+    for (v = 0; v < count; v++) {
+        key = (unsigned long long) list->x0[v];
+        key = (key << 16) | (unsigned long long) list->y0[v];
+        key = (key << 16) | (unsigned long long) list->x1[v];
+        key = (key << 16) | (unsigned long long) list->y1[v];
+
+        h = (h ^ key) * VECTOR_HASH_MUL;
+        h = (h ^ list->color[v]) * VECTOR_HASH_MUL;
+    }
+
+    return h;
+}
+
+void Vec3XEmulator::Render() {
+    display_list_t list;
+    raster_rect_t full;
+    long i;
+
+    if ((vector_draw_cnt > render_size || vector_erse_cnt > render_size) &&
+        !RenderGrow(vector_draw_cnt > vector_erse_cnt ? vector_draw_cnt : vector_erse_cnt)) {
+        _rasterValid = false;
+        _displayChanged = 0;
+        vector_id_base = vector_id_next;
+        return;
+    }
+
+    // hand the whole frame to the consumer in one call
+    memset(&list, 0, sizeof (list));
+    list.frame = ++_displayFrame;
+    list.hash = VectorListHash(&vectors_draw, vector_draw_cnt);
+    list.unchanged = _displayChanged != 0 && list.hash == _displayHash;
+    list.reset = _displayChanged == 0;
+
+    if (!list.unchanged) {
+        _displayChanged = _displayFrame;
+        _displayHash = list.hash;
+    }
+
+    list.changed = _displayChanged;
+
+    if (_mergeVectors) {
+        VectorMerge();
+        TransformPoints(strip_points, strip_point_cnt, render_screen);
+
+        list.strip_count = strip_cnt;
+        list.strips = strips;
+        list.points = render_screen;
+    } else {
+        TransformVectors(&vectors_draw, vector_draw_cnt, render_screen);
+
+        list.count = vector_draw_cnt;
+        list.lines = render_screen;
+        list.colors = vectors_draw.color;
+        list.ids = vectors_draw.id;
+
+        /* after a reset every line counts as added and nothing as removed */
+
+        for (i = 0; i < vector_draw_cnt; i++) {
+            if (list.reset || vectors_draw.id[i] - vector_id_base < vector_id_next - vector_id_base) {
+                render_added[list.added_count++] = vectors_draw.id[i];
+            }
+        }
+
+        for (i = 0; i < vector_erse_cnt && !list.reset; i++) {
+            if (vectors_erse.color[i] != VECTREX_COLORS) {
+                render_removed[list.removed_count++] = vectors_erse.id[i];
+            }
+        }
+
+        list.added = render_added;
+        list.removed = render_removed;
+    }
+
+    vector_id_base = vector_id_next;
+
+    vectrex_display_list(&list);
+
+    if (_streamVectors) {
+        vector_event_t event;
+
+        memset(&event, 0, sizeof (event));
+        event.cycle = _cycles;
+        event.frame = _displayFrame;
+        event.type = VECTOR_EVENT_FRAME;
+        event.dropped = stream_dropped;
+
+        if (StreamPush(&event)) {
+            stream_dropped = 0;
+        }
+    }
+
+#ifdef USE_PIXEL_BUFFER
+    /* merged strips join collinear neighbours into one segment, so the
+     * pixels of a kept vector may change with them. those are always
+     * drawn in full.
+     */
+
+    if (list.unchanged && _rasterValid) {
+        /* the intensity buffer already holds this frame */
+    } else if (_incrementalRaster && _rasterValid && !_mergeVectors && RasterDirty()) {
+        for (i = 0; i < raster_rect_cnt; i++) {
+            ClearRect(&raster_rects[i]);
+            RasterList(&list, &raster_rects[i]);
+        }
+    } else if (raster_threads.size() > 0) {
+        RasterParallel(&list);
+    } else {
+        full.left = 0;
+        full.top = 0;
+        full.right = _bufferWidth - 1;
+        full.bottom = _bufferHeight - 1;
+
+        ClearBuffer(0);
+        RasterList(&list, &full);
+    }
+
+    if (!list.unchanged || !_rasterValid || _phosphorDecay != 0) {
+        _imageFrame = _displayFrame;
+    }
+
+    _rasterValid = true;
+
+    if (_phosphorDecay != 0) {
+        if (_phosphorBuffer == NULL) {
+            _phosphorBuffer = (Uint8 *) calloc((_bufferWidth + 2) * (_bufferHeight + 2), 1);
+        }
+
+        if (_phosphorBuffer != NULL) {
+            PhosphorDecay();
+        }
+    }
+#endif
+}
+
+#pragma mark - Internal emulation
+
+void Vec3XEmulator::Reset() {
+    unsigned r;
+
+    // RAM
+    for (r = 0; r < 1024; r++) {
+        _ram[r] = r & 0xff;
+    }
+
+    for (r = 0; r < 16; r++) {
+        _soundRegisters[r] = 0;
+        ic8910.Write(r, 0);
+    }
+
+    // input buttons
+    _soundRegisters[14] = 0xff;
+    ic8910.Write(14, 0xff);
+
+    _soundSelect = 0;
+
+    via_ora = 0;
+    via_orb = 0;
+    via_ddra = 0;
+    via_ddrb = 0;
+    via_t1on = 0;
+    via_t1int = 0;
+    via_t1c = 0;
+    via_t1ll = 0;
+    via_t1lh = 0;
+    via_t1pb7 = 0x80;
+    via_t2on = 0;
+    via_t2int = 0;
+    via_t2c = 0;
+    via_t2ll = 0;
+    via_sr = 0;
+    via_srb = 8;
+    via_src = 0;
+    via_srclk = 0;
+    via_acr = 0;
+    via_pcr = 0;
+    via_ifr = 0;
+    via_ier = 0;
+    via_ca2 = 1;
+    via_cb2h = 1;
+    via_cb2s = 0;
+
+    SigUpdate ();
+
+    alg_rsh = 128;
+    alg_xsh = 128;
+    alg_ysh = 128;
+    alg_zsh = 0;
+    alg_jch0 = 128;
+    alg_jch1 = 128;
+    alg_jch2 = 128;
+    alg_jch3 = 128;
+    alg_jsh = 128;
+
+    alg_compare = 0;
+
+    alg_dx = 0;
+    alg_dy = 0;
+    alg_curr_x = ALG_MAX_X / 2;
+    alg_curr_y = ALG_MAX_Y / 2;
+
+    alg_vectoring = 0;
+
+    vector_draw_cnt = 0;
+    vector_erse_cnt = 0;
+    VectorHashAge(2);
+    _rasterValid = false;
+    _displayChanged = 0;
+
+    fcycles = FCYCLES_INIT;
+    frame_sync_due = false;
+    frame_carry = 0;
+
+    _cartridgeBank = _cartridge;
+    MapMemory();
+
+    ic6809.Reset();
+}
+
+long Vec3XEmulator::Emulate(long cycles, bool untilFrame) {
+    // returns the cycles left when untilFrame stopped at a game frame
+    unsigned icycles;
+    long budget;
+    bool synced;
+
+    while (cycles > 0) {
+        /* the cpu may start instructions until the slice ends or the frame
+         * redraw is due.
+         */
+
+        budget = cycles < fcycles + 1 ? cycles : fcycles + 1;
+        icycles = ic6809.Run(budget, ViaIrqCycles(), via_ifr & 0x80);
+
+        ViaSync(icycles);
+        _syncCycles = 0;
+        _cycles += icycles;
+
+        cycles -= (long) icycles;
+
+        fcycles -= (long) icycles;
+
+        if (fcycles < 0 || frame_sync_due) {
+            vector_list_t tmp;
+            long size;
+
+            /* with DEBUG_FRAME_SYNC the refresh follows the game frames
+             * found by Write8, FCYCLES_INIT only takes over while the game
+             * does not make any.
+             */
+
+            synced = frame_sync_due;
+            frame_sync_due = false;
+
+            if (synced) {
+                fcycles = FRAME_SYNC_TIMEOUT;
+            } else {
+                fcycles += FCYCLES_INIT;
+            }
+
+            Render();
+
+            // everything that was drawn during this pass now now enters
+            vector_erse_cnt = vector_draw_cnt;
+            vector_draw_cnt = 0;
+
+            tmp = vectors_erse;
+            vectors_erse = vectors_draw;
+            vectors_draw = tmp;
+
+            size = vector_erse_size;
+            vector_erse_size = vector_draw_size;
+            vector_draw_size = size;
+
+            // hash entries of the previous erase list are now free
+            VectorHashAge(1);
+
+            if (synced && untilFrame) {
+                return cycles > 0 ? cycles : 0;
+            }
+        }
+    }
+
+    return 0;
+}
+
+#pragma mark - Load file
+
+void Vec3XEmulator::LoadFile(const char* romfile, const char* romName, const char* cartfile, const char* cartName) {
+    FILE *fp;
+    char msg[255];
+    errno_t error;
+
+    error = fopen_s(&fp, romfile, "rb");
+    if (error != 0) {
+        platform_print("ERROR LOADING ROMFILE (1)");
+        return;
+    }
+
+    if (fread(_rom, 1, sizeof (_rom), fp) != sizeof (_rom)) {
+        platform_print("ERROR LOADING ROMFILE (2)");
+        return;
+    }
+    
+    fclose(fp);
+
+    sprintf_s(msg, "Rom file loaded: %s", romName);
+    platform_print(msg);
+    
+    memset(_cartridge, 0, sizeof (_cartridge));
+    _cartridgeBanks = 1;
+
+    if (cartfile) {
+        size_t size;
+
+        error = fopen_s(&fp, cartfile, "rb");
+        if (error != 0) {
+            platform_print("ERROR LOADING GAMEFILE (1)");
+            return;
+        }
+
+        size = fread(_cartridge, 1, sizeof (_cartridge), fp);
+        fclose(fp);
+
+        if (size > CARTRIDGE_BANK_SIZE) {
+            _cartridgeBanks = (unsigned) ((size + CARTRIDGE_BANK_SIZE - 1) / CARTRIDGE_BANK_SIZE);
+        }
+
+        sprintf_s(msg, "Cartridge file loaded: %s", cartName);
+        platform_print(msg);
+    }
+}
+
+#pragma mark - Memory map
+
+/* build the page table used by the cpu for plain memory accesses. only the
+ * via pages are left to Read8/Write8. 0xd800-0xdfff reads ram but writes
+ * ram and via at the same time, so it is only mapped for reading.
+ */
+
+void Vec3XEmulator::MapMemory() {
+    unsigned page;
+
+    memset(_openBus, 0xff, sizeof (_openBus));
+    memset(_zeroPage, 0, sizeof (_zeroPage));
+
+    for (page = 0; page < MEMORY_PAGES; page++) {
+        unsigned address = page * MEMORY_PAGE_SIZE;
+
+        if (address < CARTRIDGE_BANK_SIZE) {
+            _readMap[page] = _cartridgeBank + address;
+            _writeMap[page] = _sinkPage;
+        } else if (address < 0xc000) {
+            _readMap[page] = _openBus;
+            _writeMap[page] = _sinkPage;
+        } else if (address < 0xc800) {
+            _readMap[page] = _zeroPage;
+            _writeMap[page] = _sinkPage;
+        } else if (address < 0xd000) {
+            _readMap[page] = _ram + (address & 0x3ff);
+            _writeMap[page] = _ram + (address & 0x3ff);
+        } else if (address < 0xd800) {
+            _readMap[page] = NULL;
+            _writeMap[page] = NULL;
+        } else if (address < 0xe000) {
+            _readMap[page] = _ram + (address & 0x3ff);
+            _writeMap[page] = NULL;
+        } else {
+            _readMap[page] = _rom + (address & 0x1fff);
+            _writeMap[page] = _sinkPage;
+        }
+    }
+}
+
+/* cartridges larger than 32k switch banks with pb6 of the via. pb6 is
+ * pulled high while it is an input, which selects the first bank the
+ * cartridge boots from, driving it low selects the second bank. only the
+ * cartridge pages of the memory map are swapped, nothing is copied.
+ */
+
+void Vec3XEmulator::BankUpdate() {
+    unsigned char *bank;
+    unsigned page;
+
+    if (_cartridgeBanks < 2) {
+        return;
+    }
+
+    if ((via_ddrb & 0x40) && (via_orb & 0x40) == 0) {
+        bank = _cartridge + CARTRIDGE_BANK_SIZE;
+    } else {
+        bank = _cartridge;
+    }
+
+    if (bank == _cartridgeBank) {
+        return;
+    }
+
+    _cartridgeBank = bank;
+
+    for (page = 0; page < CARTRIDGE_BANK_SIZE / MEMORY_PAGE_SIZE; page++) {
+        _readMap[page] = _cartridgeBank + page * MEMORY_PAGE_SIZE;
+    }
+
+    /* code seen through the old bank is no longer valid */
+
+    ic6809.FlushCartridge();
+}
+
+#pragma mark - Screen resizing
+
+void Vec3XEmulator::ResizeScreen(int width, int height) {
+    long sclx, scly;
+
+    long screenx = width;
+    long screeny = height;
+    
+    CreateBuffer(screenx, screeny);
+
+    sclx = ALG_MAX_X / width;
+    scly = ALG_MAX_Y / height;
+
+    _scaling = sclx > scly ? sclx : scly;
+
+    _xOffset = (screenx - ALG_MAX_X / _scaling) / 2;
+    _yOffset = (screeny - ALG_MAX_Y / _scaling) / 2;
+}
+
+#pragma mark - Key events
+
+void Vec3XEmulator::Key(int vk, int pressed) {
+    if (pressed) {
+        switch (vk) {
+            case PL1_LEFT:
+                _soundRegisters[14] &= ~0x01;
+                break;
+            case PL1_RIGHT:
+                _soundRegisters[14] &= ~0x02;
+                break;
+            case PL1_UP:
+                _soundRegisters[14] &= ~0x04;
+                break;
+            case PL1_DOWN:
+                _soundRegisters[14] &= ~0x08;
+                break;
+                
+            case PL2_LEFT:
+                alg_jch0 = 0x00;
+                break;
+            case PL2_RIGHT:
+                alg_jch0 = 0xff;
+                break;
+            case PL2_UP:
+                alg_jch1 = 0xff;
+                break;
+            case PL2_DOWN:
+                alg_jch1 = 0x00;
+                break;
+        }
+    }
+    else {
+        switch (vk) {
+            case PL1_LEFT:
+                _soundRegisters[14] |= 0x01;
+                break;
+            case PL1_RIGHT:
+                _soundRegisters[14] |= 0x02;
+                break;
+            case PL1_UP:
+                _soundRegisters[14] |= 0x04;
+                break;
+            case PL1_DOWN:
+                _soundRegisters[14] |= 0x08;
+                break;
+                
+            case PL2_LEFT:
+                alg_jch0 = 0x80;
+                break;
+            case PL2_RIGHT:
+                alg_jch0 = 0x80;
+                break;
+            case PL2_UP:
+                alg_jch1 = 0x80;
+                break;
+            case PL2_DOWN:
+                alg_jch1 = 0x80;
+                break;
+        }
+    }
+}
+
+void Vec3XEmulator::Init(int width, int height) {
+    ResizeScreen(width, height);
+    _paused = false;
+}
+
+void Vec3XEmulator::Start(const char* romfile, const char* romName, const char* cartfile, const char* cartName) {
+    LoadFile(romfile, romName, cartfile, cartName);
+
+    ic8910.Start(&_soundRegisters[0]);
+    audio_processor_start(&ic8910);
+
+    Reset();
+    
+    _isInitialised = true;
+}
+
+void Vec3XEmulator::Frame() {
+    long cycles;
+
+    if (!_isInitialised) {
+        return;
+    }
+    
+    if (_paused) {
+        return;
+    }
+
+    cycles = (VECTREX_MHZ / 1000) * EMU_TIMER;
+
+    if (_frameSync) {
+        /* stop after the first game frame and leave the rest of the slice
+         * to the next call, so every call shows one whole game frame while
+         * the emulated clock keeps its pace. a game that makes frames
+         * faster than they are shown runs on once a full slice is owed.
+         */
+
+        frame_carry += cycles;
+        frame_carry = Emulate(frame_carry, frame_carry < 2 * cycles);
+    } else {
+        Emulate(cycles, false);
+    }
+
+    vectrex_render_frame((byte *)GetPixels(_pixelFormat));
+    
+    if (_liveUpdate) {
+        vectrex_update_cpu_view(vectrex_get_register(VECTREX_PC), vectrex_get_register(VECTREX_USP), vectrex_get_register(VECTREX_HSP), vectrex_get_register(VECTREX_ACC_A), vectrex_get_register(VECTREX_ACC_B), vectrex_get_register(VECTREX_REG_X), vectrex_get_register(VECTREX_REG_Y), vectrex_get_register(VECTREX_REG_DP), vectrex_get_register(VECTREX_REG_CC), vector_draw_cnt);
+    }
+}
+
+void Vec3XEmulator::Stop() {
+    ic8910.Stop();
+    audio_processor_stop();
+    _isInitialised = 0;
+}
+
+void Vec3XEmulator::Pause(void) {
+    _paused = 1;
+}
+
+void Vec3XEmulator::Resume(void) {
+    _paused = 0;
+}
+
+void Vec3XEmulator::Command(int command, int parameter) {
+    switch (command) {
+        case DEBUG_LIVE_UPDATE:
+            _liveUpdate = !_liveUpdate;
+            break;
+        case DEBUG_VECTOR_MERGE:
+            _mergeVectors = parameter != 0;
+            _rasterValid = false;
+            break;
+        case DEBUG_ANTIALIAS:
+            _antialias = parameter != 0;
+            _rasterValid = false;
+            break;
+        case DEBUG_INCREMENTAL_RASTER:
+            _incrementalRaster = parameter != 0;
+            break;
+        case DEBUG_RASTER_THREADS:
+            RasterThreads(parameter);
+            break;
+        case DEBUG_VECTOR_STREAM:
+            /* the ring stays allocated when streaming is turned off, a
+             * reader may still be draining it.
+             */
+            if (parameter != 0 && stream_events == NULL) {
+                stream_events = (vector_event_t *)malloc(sizeof (vector_event_t) * VECTOR_STREAM_SIZE);
+            }
+
+            _streamVectors = parameter != 0 && stream_events != NULL;
+            break;
+        case DEBUG_FRAME_SYNC:
+            _frameSync = parameter != 0;
+            frame_sync_due = false;
+            frame_carry = 0;
+
+            if (fcycles > FCYCLES_INIT) {
+                fcycles = FCYCLES_INIT;
+            }
+            break;
+        case DEBUG_PHOSPHOR:
+            /* start from a dark screen */
+            _phosphorDecay = parameter < 0 ? 0 : parameter > 255 ? 255 : parameter;
+            free(_phosphorBuffer);
+            _phosphorBuffer = NULL;
+            _pixelBufferFormat = PIXEL_FORMAT_NONE;
+            break;
+        case DEBUG_RASTER_BENCHMARK:
+            RasterBenchmark();
+            break;
+    }
+}
+
+#pragma mark - Internal bus handling
+
+void Vec3XEmulator::SndUpdate() {
+    switch (via_orb & 0x18) {
+    case 0x00:
+        /* the sound chip is disabled */
+        break;
+    case 0x08:
+        /* the sound chip is sending data */
+        break;
+    case 0x10:
+        /* the sound chip is recieving data */
+
+        if (_soundSelect != 14) {
+            _soundRegisters[_soundSelect] = via_ora;
+            ic8910.Write(_soundSelect, via_ora);
+        }
+
+        break;
+    case 0x18:
+        /* the sound chip is latching an address */
+
+        if ((via_ora & 0xf0) == 0x00) {
+            _soundSelect = via_ora & 0x0f;
+        }
+
+        break;
+    }
+}
+
+void Vec3XEmulator::AlgUpdate() {
+    // update the various analog values when orb is written.
+    switch (via_orb & 0x06) {
+    case 0x00:
+        alg_jsh = alg_jch0;
+
+        if ((via_orb & 0x01) == 0x00) {
+            /* demultiplexor is on */
+            alg_ysh = alg_xsh;
+        }
+
+        break;
+    case 0x02:
+        alg_jsh = alg_jch1;
+
+        if ((via_orb & 0x01) == 0x00) {
+            /* demultiplexor is on */
+            alg_rsh = alg_xsh;
+        }
+
+        break;
+    case 0x04:
+        alg_jsh = alg_jch2;
+
+        if ((via_orb & 0x01) == 0x00) {
+            /* demultiplexor is on */
+
+            if (alg_xsh > 0x80) {
+                alg_zsh = alg_xsh - 0x80;
+            } else {
+                alg_zsh = 0;
+            }
+        }
+
+        break;
+    case 0x06:
+        /* sound output line */
+        alg_jsh = alg_jch3;
+        break;
+    }
+
+    /* compare the current joystick direction with a reference */
+
+    if (alg_jsh > alg_xsh) {
+        alg_compare = 0x20;
+    } else {
+        alg_compare = 0;
+    }
+
+    /* compute the new "deltas" */
+
+    alg_dx = (long) alg_xsh - (long) alg_rsh;
+    alg_dy = (long) alg_rsh - (long) alg_ysh;
+}
+
+void Vec3XEmulator::SigUpdate() {
+    // update the blank and ramp signals seen by the analog part after a
+    // change of the via lines that drive them
+    if ((via_acr & 0x10) == 0x10) {
+        alg_blank = via_cb2s;
+    } else {
+        alg_blank = via_cb2h;
+    }
+
+    if (via_acr & 0x80) {
+        alg_ramp = via_t1pb7;
+    } else {
+        alg_ramp = via_orb & 0x80;
+    }
+}
+
+void Vec3XEmulator::IntUpdate() {
+    // update IRQ and bit-7 of the ifr register after making an adjustment to ifr
+    if ((via_ifr & 0x7f) & (via_ier & 0x7f)) {
+        via_ifr |= 0x80;
+    }
+    else {
         via_ifr &= 0x7f;
     }
-}
+}
+
+unsigned char Vec3XEmulator::Read8(unsigned address) {
+    unsigned char data = 0;
+
+    if ((address & 0xe000) == 0xe000) {
+        /* rom */
+
+        data = _rom[address & 0x1fff];
+    } else if ((address & 0xe000) == 0xc000) {
+        if (address & 0x800) {
+            /* ram */
+
+            data = _ram[address & 0x3ff];
+        } else if (address & 0x1000) {
+            /* io, the via first catches up with the current cpu run. reads
+             * of counters and reads with side effects end the run.
+             */
+
+            ViaSync(ic6809.GetRunCycles());
+
+            switch (address & 0xf) {
+            case 0x0:
+                /* compare signal is an input so the value does not come from
+                 * via_orb.
+                 */
+
+                if (via_acr & 0x80) {
+                    /* timer 1 has control of bit 7 */
+
+                    data = (unsigned char) ((via_orb & 0x5f) | via_t1pb7 | alg_compare);
+                } else {
+                    /* bit 7 is being driven by via_orb */
+
+                    data = (unsigned char) ((via_orb & 0xdf) | alg_compare);
+                }
+
+                break;
+            case 0x1:
+                /* register 1 also performs handshakes if necessary */
+
+                if ((via_pcr & 0x0e) == 0x08) {
+                    /* if ca2 is in pulse mode or handshake mode, then it
+                     * goes low whenever ira is read.
+                     */
+
+                    via_ca2 = 0;
+                    ic6809.StopRun();
+                }
+
+                /* fall through */
+
+            case 0xf:
+                if ((via_orb & 0x18) == 0x08) {
+                    /* the snd chip is driving port a */
+
+                    data = (unsigned char) _soundRegisters[_soundSelect];
+                } else {
+                    data = (unsigned char) via_ora;
+                }
+
+                break;
+            case 0x2:
+                data = (unsigned char) via_ddrb;
+                break;
+            case 0x3:
+                data = (unsigned char) via_ddra;
+                break;
+            case 0x4:
+                /* T1 low order counter */
+
+                data = (unsigned char) via_t1c;
+                ic6809.StopRun();
+                via_ifr &= 0xbf; /* remove timer 1 interrupt flag */
+
+                via_t1on = 0; /* timer 1 is stopped */
+                via_t1int = 0;
+                via_t1pb7 = 0x80;
+
+                IntUpdate ();
+
+                break;
+            case 0x5:
+                /* T1 high order counter */
+
+                data = (unsigned char) (via_t1c >> 8);
+                ic6809.StopRun();
+
+                break;
+            case 0x6:
+                /* T1 low order latch */
+
+                data = (unsigned char) via_t1ll;
+                break;
+            case 0x7:
+                /* T1 high order latch */
+
+                data = (unsigned char) via_t1lh;
+                break;
+            case 0x8:
+                /* T2 low order counter */
+
+                data = (unsigned char) via_t2c;
+                ic6809.StopRun();
+                via_ifr &= 0xdf; /* remove timer 2 interrupt flag */
+
+                via_t2on = 0; /* timer 2 is stopped */
+                via_t2int = 0;
+
+                IntUpdate ();
+
+                break;
+            case 0x9:
+                /* T2 high order counter */
+
+                data = (unsigned char) (via_t2c >> 8);
+                ic6809.StopRun();
+                break;
+            case 0xa:
+                data = (unsigned char) via_sr;
+                ic6809.StopRun();
+                via_ifr &= 0xfb; /* remove shift register interrupt flag */
+                via_srb = 0;
+                via_srclk = 1;
+
+                IntUpdate ();
+
+                break;
+            case 0xb:
+                data = (unsigned char) via_acr;
+                break;
+            case 0xc:
+                data = (unsigned char) via_pcr;
+                break;
+            case 0xd:
+                /* interrupt flag register */
+
+                data = (unsigned char) via_ifr;
+                break;
+            case 0xe:
+                /* interrupt enable register */
+
+                data = (unsigned char) (via_ier | 0x80);
+                break;
+            }
+
+            SigUpdate ();
+        }
+    } else if (address < 0x8000) {
+        /* cartridge */
+
+        data = _cartridgeBank[address];
+    } else {
+        data = 0xff;
+    }
+
+    return data;
+}
+
+void Vec3XEmulator::Write8(unsigned address, unsigned char data) {
+    if ((address & 0xe000) == 0xe000) {
+        /* rom */
+    } else if ((address & 0xe000) == 0xc000) {
+        /* it is possible for both ram and io to be written at the same! */
+
+        if (address & 0x800) {
+            _ram[address & 0x3ff] = data;
+        }
+
+        if (address & 0x1000) {
+            ViaSync(ic6809.GetRunCycles());
+            ic6809.StopRun();
+
+            switch (address & 0xf) {
+            case 0x0:
+                via_orb = data;
+
+                SndUpdate ();
+
+                AlgUpdate ();
+
+                BankUpdate ();
+
+                if ((via_pcr & 0xe0) == 0x80) {
+                    /* if cb2 is in pulse mode or handshake mode, then it
+                     * goes low whenever orb is written.
+                     */
+
+                    via_cb2h = 0;
+                }
+
+                break;
+            case 0x1:
+                /* register 1 also performs handshakes if necessary */
+
+                if ((via_pcr & 0x0e) == 0x08) {
+                    /* if ca2 is in pulse mode or handshake mode, then it
+                     * goes low whenever ora is written.
+                     */
+
+                    via_ca2 = 0;
+                }
+
+                /* fall through */
+
+            case 0xf:
+                via_ora = data;
+
+                SndUpdate ();
+
+                /* output of port a feeds directly into the dac which then
+                 * feeds the x axis sample and hold.
+                 */
+
+                alg_xsh = data ^ 0x80;
+
+                AlgUpdate ();
+
+                break;
+            case 0x2:
+                via_ddrb = data;
+
+                BankUpdate ();
+
+                break;
+            case 0x3:
+                via_ddra = data;
+                break;
+            case 0x4:
+                /* T1 low order counter */
+
+                via_t1ll = data;
+
+                break;
+            case 0x5:
+                /* T1 high order counter */
+
+                via_t1lh = data;
+                via_t1c = (via_t1lh << 8) | via_t1ll;
+                via_ifr &= 0xbf; /* remove timer 1 interrupt flag */
+
+                via_t1on = 1; /* timer 1 starts running */
+                via_t1int = 1;
+                via_t1pb7 = 0;
+
+                IntUpdate ();
+
+                break;
+            case 0x6:
+                /* T1 low order latch */
+
+                via_t1ll = data;
+                break;
+            case 0x7:
+                /* T1 high order latch */
+
+                via_t1lh = data;
+                break;
+            case 0x8:
+                /* T2 low order latch */
+
+                via_t2ll = data;
+                break;
+            case 0x9:
+                /* T2 high order latch/counter */
+
+                via_t2c = (data << 8) | via_t2ll;
+
+                if (_frameSync && (via_ifr & 0x20)) {
+                    /* reloading the timer after it ran out is how
+                     * Wait_Recal starts a game frame, the refresh follows
+                     * once this instruction is done.
+                     */
+
+                    frame_sync_due = true;
+                }
+
+                via_ifr &= 0xdf;
+
+                via_t2on = 1; /* timer 2 starts running */
+                via_t2int = 1;
+
+                IntUpdate ();
+
+                break;
+            case 0xa:
+                via_sr = data;
+                via_ifr &= 0xfb; /* remove shift register interrupt flag */
+                via_srb = 0;
+                via_srclk = 1;
+
+                IntUpdate ();
+
+                break;
+            case 0xb:
+                via_acr = data;
+                break;
+            case 0xc:
+                via_pcr = data;
+
+
+                if ((via_pcr & 0x0e) == 0x0c) {
+                    /* ca2 is outputting low */
+
+                    via_ca2 = 0;
+                } else {
+                    /* ca2 is disabled or in pulse mode or is
+                     * outputting high.
+                     */
+
+                    via_ca2 = 1;
+                }
+
+                if ((via_pcr & 0xe0) == 0xc0) {
+                    /* cb2 is outputting low */
+
+                    via_cb2h = 0;
+                } else {
+                    /* cb2 is disabled or is in pulse mode or is
+                     * outputting high.
+                     */
+
+                    via_cb2h = 1;
+                }
+
+                break;
+            case 0xd:
+                /* interrupt flag register */
+
+                via_ifr &= ~(data & 0x7f);
+                IntUpdate ();
+
+                break;
+            case 0xe:
+                /* interrupt enable register */
+
+                if (data & 0x80) {
+                    via_ier |= data & 0x7f;
+                } else {
+                    via_ier &= ~(data & 0x7f);
+                }
+
+                IntUpdate ();
+
+                break;
+            }
+
+            SigUpdate ();
+        }
+    } else if (address < 0x8000) {
+        /* cartridge */
+    }
+}
+
+void Vec3XEmulator::ViaSstep0() {
+    // Perform a single cycle worth of via emulation via_sstep0 is the first postion of the emulation.
+    unsigned t2shift;
+
+    if (via_t1on) {
+        via_t1c--;
+
+        if ((via_t1c & 0xffff) == 0xffff) {
+            /* counter just rolled over */
+
+            if (via_acr & 0x40) {
+                /* continuous interrupt mode */
+
+                via_ifr |= 0x40;
+                IntUpdate ();
+                via_t1pb7 = 0x80 - via_t1pb7;
+
+                /* reload counter */
+
+                via_t1c = (via_t1lh << 8) | via_t1ll;
+            } else {
+                /* one shot mode */
+
+                if (via_t1int) {
+                    via_ifr |= 0x40;
+                    IntUpdate ();
+                    via_t1pb7 = 0x80;
+                    via_t1int = 0;
+                }
+            }
+        }
+    }
+
+    if (via_t2on && (via_acr & 0x20) == 0x00) {
+        via_t2c--;
+
+        if ((via_t2c & 0xffff) == 0xffff) {
+            /* one shot mode */
+
+            if (via_t2int) {
+                via_ifr |= 0x20;
+                IntUpdate ();
+                via_t2int = 0;
+            }
+        }
+    }
+
+    /* shift counter */
+
+    via_src--;
+
+    if ((via_src & 0xff) == 0xff) {
+        via_src = via_t2ll;
+
+        if (via_srclk) {
+            t2shift = 1;
+            via_srclk = 0;
+        } else {
+            t2shift = 0;
+            via_srclk = 1;
+        }
+    } else {
+        t2shift = 0;
+    }
+
+    if (via_srb < 8) {
+        switch (via_acr & 0x1c) {
+        case 0x00:
+            /* disabled */
+            break;
+        case 0x04:
+            /* shift in under control of t2 */
+
+            if (t2shift) {
+                /* shifting in 0s since cb2 is always an output */
+
+                via_sr <<= 1;
+                via_srb++;
+            }
+
+            break;
+        case 0x08:
+            /* shift in under system clk control */
+
+            via_sr <<= 1;
+            via_srb++;
+
+            break;
+        case 0x0c:
+            /* shift in under cb1 control */
+            break;
+        case 0x10:
+            /* shift out under t2 control (free run) */
+
+            if (t2shift) {
+                via_cb2s = (via_sr >> 7) & 1;
+
+                via_sr <<= 1;
+                via_sr |= via_cb2s;
+            }
+
+            break;
+        case 0x14:
+            /* shift out under t2 control */
+
+            if (t2shift) {
+                via_cb2s = (via_sr >> 7) & 1;
+
+                via_sr <<= 1;
+                via_sr |= via_cb2s;
+                via_srb++;
+            }
+
+            break;
+        case 0x18:
+            /* shift out under system clock control */
+
+            via_cb2s = (via_sr >> 7) & 1;
+
+            via_sr <<= 1;
+            via_sr |= via_cb2s;
+            via_srb++;
+
+            break;
+        case 0x1c:
+            /* shift out under cb1 control */
+            break;
+        }
+
+        if (via_srb == 8) {
+            via_ifr |= 0x04;
+            IntUpdate ();
+        }
+    }
+
+    SigUpdate ();
+}
+
+void Vec3XEmulator::ViaSync(unsigned cycles) {
+    // bring via and analog up to the given cycle of the current cpu run.
+    // only the cycles with a timer or shift register event are stepped,
+    // in between the counters are advanced in one go and the analog part
+    // runs on its own since the signals driving it stay the same.
+    unsigned count;
+    long event;
+
+    while (_syncCycles < cycles) {
+        count = cycles - _syncCycles;
+        event = ViaEventCycles(0x7f);
+
+        if (((via_pcr & 0x0e) == 0x0a && via_ca2 == 0) ||
+            ((via_pcr & 0xe0) == 0xa0 && via_cb2h == 0)) {
+            /* a pulse on ca2 or cb2 ends after this cycle */
+
+            count = 0;
+        } else if ((long) count >= event) {
+            count = (unsigned) (event - 1);
+        }
+
+        alg_cycle = _cycles + _syncCycles;
+
+        if (count > 0) {
+            ViaSkip(count);
+            AlgRun(count);
+            _syncCycles += count;
+        } else {
+            ViaSstep0();
+            AlgSstep();
+            ViaSstep1();
+            _syncCycles++;
+        }
+    }
+}
+
+void Vec3XEmulator::ViaSkip(unsigned cycles) {
+    // advance the via by a number of cycles before its next timer or shift
+    // register event, the closed form of ViaSstep0 for these cycles
+    unsigned low, period, rollovers;
+
+    if (via_t1on) {
+        via_t1c -= cycles;
+    }
+
+    if (via_t2on && (via_acr & 0x20) == 0x00) {
+        via_t2c -= cycles;
+    }
 
-unsigned char Vec3XEmulator::Read8(unsigned address) {
-    unsigned char data = 0;
+    /* the shift counter reloads from the t2 low latch whenever its low
+     * byte rolls over, toggling the shift clock.
+     */
 
-    if ((address & 0xe000) == 0xe000) {
-        /* rom */
+    low = via_src & 0xff;
 
-        data = _rom[address & 0x1fff];
-    } else if ((address & 0xe000) == 0xc000) {
-        if (address & 0x800) {
-            /* ram */
+    if (cycles <= low) {
+        via_src -= cycles;
+    } else {
+        cycles -= low + 1;
+        period = via_t2ll + 1;
+        rollovers = 1 + cycles / period;
 
-            data = _ram[address & 0x3ff];
-        } else if (address & 0x1000) {
-            /* io */
+        via_src = via_t2ll - cycles % period;
 
-            switch (address & 0xf) {
-            case 0x0:
-                /* compare signal is an input so the value does not come from
-                 * via_orb.
-                 */
+        if (rollovers & 1) {
+            via_srclk = via_srclk ? 0 : 1;
+        }
+    }
+}
 
-                if (via_acr & 0x80) {
-                    /* timer 1 has control of bit 7 */
+long Vec3XEmulator::ViaEventCycles(unsigned flags) {
+    // number of the cycle in which the next timer or shift register event
+    // selected by the interrupt flags happens. until then only the counters
+    // change, any other change needs an i/o access.
+    long next = LONG_MAX;
+    long shift;
 
-                    data = (unsigned char) ((via_orb & 0x5f) | via_t1pb7 | alg_compare);
-                } else {
-                    /* bit 7 is being driven by via_orb */
+    if ((flags & 0x40) && via_t1on && ((via_acr & 0x40) || via_t1int)) {
+        next = (long) (via_t1c & 0xffff) + 1;
+    }
 
-                    data = (unsigned char) ((via_orb & 0xdf) | alg_compare);
-                }
+    if ((flags & 0x20) && via_t2on && (via_acr & 0x20) == 0x00 && via_t2int) {
+        if ((long) (via_t2c & 0xffff) + 1 < next) {
+            next = (long) (via_t2c & 0xffff) + 1;
+        }
+    }
 
-                break;
-            case 0x1:
-                /* register 1 also performs handshakes if necessary */
+    if ((flags & 0x04) && via_srb < 8) {
+        switch (via_acr & 0x1c) {
+        case 0x04:
+        case 0x10:
+        case 0x14:
+            /* shifting under t2 control happens on every other rollover
+             * of the shift counter.
+             */
 
-                if ((via_pcr & 0x0e) == 0x08) {
-                    /* if ca2 is in pulse mode or handshake mode, then it
-                     * goes low whenever ira is read.
-                     */
+            shift = (long) (via_src & 0xff) + 1;
 
-                    via_ca2 = 0;
-                }
+            if (via_srclk == 0) {
+                shift += (long) via_t2ll + 1;
+            }
 
-                /* fall through */
+            if (shift < next) {
+                next = shift;
+            }
 
-            case 0xf:
-                if ((via_orb & 0x18) == 0x08) {
-                    /* the snd chip is driving port a */
+            break;
+        case 0x08:
+        case 0x18:
+            /* shifting under system clock control, every cycle */
 
-                    data = (unsigned char) _soundRegisters[_soundSelect];
-                } else {
-                    data = (unsigned char) via_ora;
-                }
+            next = 1;
+            break;
+        }
+    }
 
-                break;
-            case 0x2:
-                data = (unsigned char) via_ddrb;
-                break;
-            case 0x3:
-                data = (unsigned char) via_ddra;
-                break;
-            case 0x4:
-                /* T1 low order counter */
+    return next;
+}
 
-                data = (unsigned char) via_t1c;
-                via_ifr &= 0xbf; /* remove timer 1 interrupt flag */
+long Vec3XEmulator::ViaEventCycle() {
+    // cycle of the current cpu run up to which reads of the via see the
+    // same values, see ViaEventCycles
+    long event = ViaEventCycles(0x7f);
 
-                via_t1on = 0; /* timer 1 is stopped */
-                via_t1int = 0;
-                via_t1pb7 = 0x80;
+    if (event > LONG_MAX - (long) _syncCycles) {
+        return LONG_MAX;
+    }
 
-                IntUpdate ();
+    return (long) _syncCycles + event;
+}
 
-                break;
-            case 0x5:
-                /* T1 high order counter */
+long Vec3XEmulator::ViaIrqCycles() {
+    // number of cycles before a via timer can raise the irq line. it can
+    // also change through an i/o access, which ends a cpu run anyway.
+    if (via_ifr & 0x80) {
+        /* flags are only cleared by i/o */
 
-                data = (unsigned char) (via_t1c >> 8);
+        return LONG_MAX;
+    }
 
-                break;
-            case 0x6:
-                /* T1 low order latch */
+    return ViaEventCycles(via_ier);
+}
 
-                data = (unsigned char) via_t1ll;
-                break;
-            case 0x7:
-                /* T1 high order latch */
+void Vec3XEmulator::ViaSstep1() {
+    // perform the second part of the via emulation
+    if ((via_pcr & 0x0e) == 0x0a) {
+        /* if ca2 is in pulse mode, then make sure
+         * it gets restored to '1' after the pulse.
+         */
 
-                data = (unsigned char) via_t1lh;
-                break;
-            case 0x8:
-                /* T2 low order counter */
+        via_ca2 = 1;
+    }
 
-                data = (unsigned char) via_t2c;
-                via_ifr &= 0xdf; /* remove timer 2 interrupt flag */
+    if ((via_pcr & 0xe0) == 0xa0) {
+        /* if cb2 is in pulse mode, then make sure
+         * it gets restored to '1' after the pulse.
+         */
 
-                via_t2on = 0; /* timer 2 is stopped */
-                via_t2int = 0;
+        via_cb2h = 1;
+    }
 
-                IntUpdate ();
+    SigUpdate ();
+}
 
-                break;
-            case 0x9:
-                /* T2 high order counter */
+bool Vec3XEmulator::VectorGrow() {
+    // make room for one more vector on the draw list
+    unsigned char *block;
+    vector_list_t vectors;
+    long size;
 
-                data = (unsigned char) (via_t2c >> 8);
-                break;
-            case 0xa:
-                data = (unsigned char) via_sr;
-                via_ifr &= 0xfb; /* remove shift register interrupt flag */
-                via_srb = 0;
-                via_srclk = 1;
+    if (vector_draw_size >= VECTOR_CNT) {
+        return false;
+    }
 
-                IntUpdate ();
+    size = vector_draw_size == 0 ? (long) VECTOR_LIST_INIT : vector_draw_size * 2;
 
-                break;
-            case 0xb:
-                data = (unsigned char) via_acr;
-                break;
-            case 0xc:
-                data = (unsigned char) via_pcr;
-                break;
-            case 0xd:
-                /* interrupt flag register */
+    if (size > VECTOR_CNT) {
+        size = VECTOR_CNT;
+    }
 
-                data = (unsigned char) via_ifr;
-                break;
-            case 0xe:
-                /* interrupt enable register */
+    block = (unsigned char *) malloc(size * (4 * sizeof (unsigned short) + sizeof (unsigned) + 2));
 
-                data = (unsigned char) (via_ier | 0x80);
-                break;
-            }
-        }
-    } else if (address < 0x8000) {
-        /* cartridge */
+    if (block == NULL) {
+        return false;
+    }
 
-        data = _cartridge[address];
-    } else {
-        data = 0xff;
+    vectors.x0 = (unsigned short *) block;
+    vectors.y0 = vectors.x0 + size;
+    vectors.x1 = vectors.y0 + size;
+    vectors.y1 = vectors.x1 + size;
+    vectors.id = (unsigned *) (vectors.y1 + size);
+    vectors.color = (unsigned char *) (vectors.id + size);
+    vectors.kept = vectors.color + size;
+
+    if (vector_draw_cnt > 0) {
+        memcpy(vectors.x0, vectors_draw.x0, vector_draw_cnt * sizeof (unsigned short));
+        memcpy(vectors.y0, vectors_draw.y0, vector_draw_cnt * sizeof (unsigned short));
+        memcpy(vectors.x1, vectors_draw.x1, vector_draw_cnt * sizeof (unsigned short));
+        memcpy(vectors.y1, vectors_draw.y1, vector_draw_cnt * sizeof (unsigned short));
+        memcpy(vectors.id, vectors_draw.id, vector_draw_cnt * sizeof (unsigned));
+        memcpy(vectors.color, vectors_draw.color, vector_draw_cnt);
+        memcpy(vectors.kept, vectors_draw.kept, vector_draw_cnt);
     }
 
-    return data;
+    free(vectors_draw.x0);
+    vectors_draw = vectors;
+    vector_draw_size = size;
+
+    return true;
 }
 
-void Vec3XEmulator::Write8(unsigned address, unsigned char data) {
-    if ((address & 0xe000) == 0xe000) {
-        /* rom */
-    } else if ((address & 0xe000) == 0xc000) {
-        /* it is possible for both ram and io to be written at the same! */
+bool Vec3XEmulator::VectorHashGrow() {
+    // resize the hash table, keeping the entries of this and the last frame
+    vector_slot_t *slots;
+    vector_slot_t *slot;
+    unsigned bits;
+    unsigned long size;
+    unsigned long i;
+    unsigned long h;
+    unsigned p;
 
-        if (address & 0x800) {
-            _ram[address & 0x3ff] = data;
-        }
+    bits = vector_hash_bits == 0 ? (unsigned) VECTOR_HASH_INIT_BITS : vector_hash_bits + 1;
+    size = 1UL << bits;
 
-        if (address & 0x1000) {
-            switch (address & 0xf) {
-            case 0x0:
-                via_orb = data;
+    slots = (vector_slot_t *) calloc(size, sizeof (vector_slot_t));
 
-                SndUpdate ();
+    if (slots == NULL) {
+        return false;
+    }
 
-                AlgUpdate ();
+    for (i = 0; vector_hash != NULL && i < (1UL << vector_hash_bits); i++) {
+        if (vector_hash[i].gen + 1 < vector_gen) {
+            continue;
+        }
 
-                if ((via_pcr & 0xe0) == 0x80) {
-                    /* if cb2 is in pulse mode or handshake mode, then it
-                     * goes low whenever orb is written.
-                     */
+        h = (unsigned long) ((vector_hash[i].key * VECTOR_HASH_MUL) >> (64 - bits));
 
-                    via_cb2h = 0;
-                }
+        for (p = 0; p < VECTOR_HASH_PROBE; p++) {
+            slot = &slots[(h + p) & (size - 1)];
 
+            if (slot->gen == 0) {
+                *slot = vector_hash[i];
                 break;
-            case 0x1:
-                /* register 1 also performs handshakes if necessary */
-
-                if ((via_pcr & 0x0e) == 0x08) {
-                    /* if ca2 is in pulse mode or handshake mode, then it
-                     * goes low whenever ora is written.
-                     */
-
-                    via_ca2 = 0;
-                }
+            }
+        }
 
-                /* fall through */
+        if (p == VECTOR_HASH_PROBE) {
+            vector_stats.collisions++;
+        }
+    }
 
-            case 0xf:
-                via_ora = data;
+    free(vector_hash);
+    vector_hash = slots;
+    vector_hash_bits = bits;
 
-                SndUpdate ();
+    return true;
+}
 
-                /* output of port a feeds directly into the dac which then
-                 * feeds the x axis sample and hold.
-                 */
+void Vec3XEmulator::VectorHashAge(unsigned frames) {
+    // advance the generation, the table is only cleared when it wraps
+    vector_gen += frames;
 
-                alg_xsh = data ^ 0x80;
+    if (vector_gen < frames + 2) {
+        if (vector_hash != NULL) {
+            memset(vector_hash, 0, sizeof (vector_slot_t) << vector_hash_bits);
+        }
 
-                AlgUpdate ();
+        vector_gen = 2;
+    }
+}
 
-                break;
-            case 0x2:
-                via_ddrb = data;
-                break;
-            case 0x3:
-                via_ddra = data;
-                break;
-            case 0x4:
-                /* T1 low order counter */
+bool Vec3XEmulator::RenderGrow(long vectors) {
+    // make room to render a draw list with the given length
+    vector_strip_t *nstrips;
+    vector_point_t *npoints;
+    int *nscreen;
+    unsigned *nadded;
+    unsigned *nremoved;
+    long size;
 
-                via_t1ll = data;
+    size = render_size == 0 ? (long) VECTOR_LIST_INIT : render_size;
 
-                break;
-            case 0x5:
-                /* T1 high order counter */
+    while (size < vectors) {
+        size *= 2;
+    }
 
-                via_t1lh = data;
-                via_t1c = (via_t1lh << 8) | via_t1ll;
-                via_ifr &= 0xbf; /* remove timer 1 interrupt flag */
+    nstrips = (vector_strip_t *) realloc(strips, size * sizeof (vector_strip_t));
 
-                via_t1on = 1; /* timer 1 starts running */
-                via_t1int = 1;
-                via_t1pb7 = 0;
+    if (nstrips != NULL) {
+        strips = nstrips;
+    }
 
-                IntUpdate ();
+    npoints = (vector_point_t *) realloc(strip_points, size * 2 * sizeof (vector_point_t));
 
-                break;
-            case 0x6:
-                /* T1 low order latch */
+    if (npoints != NULL) {
+        strip_points = npoints;
+    }
 
-                via_t1ll = data;
-                break;
-            case 0x7:
-                /* T1 high order latch */
+    nscreen = (int *) realloc(render_screen, size * 4 * sizeof (int));
 
-                via_t1lh = data;
-                break;
-            case 0x8:
-                /* T2 low order latch */
+    if (nscreen != NULL) {
+        render_screen = nscreen;
+    }
 
-                via_t2ll = data;
-                break;
-            case 0x9:
-                /* T2 high order latch/counter */
+    nadded = (unsigned *) realloc(render_added, size * sizeof (unsigned));
 
-                via_t2c = (data << 8) | via_t2ll;
-                via_ifr &= 0xdf;
+    if (nadded != NULL) {
+        render_added = nadded;
+    }
 
-                via_t2on = 1; /* timer 2 starts running */
-                via_t2int = 1;
+    nremoved = (unsigned *) realloc(render_removed, size * sizeof (unsigned));
 
-                IntUpdate ();
+    if (nremoved != NULL) {
+        render_removed = nremoved;
+    }
 
-                break;
-            case 0xa:
-                via_sr = data;
-                via_ifr &= 0xfb; /* remove shift register interrupt flag */
-                via_srb = 0;
-                via_srclk = 1;
+    if (nstrips == NULL || npoints == NULL || nscreen == NULL || nadded == NULL || nremoved == NULL) {
+        return false;
+    }
 
-                IntUpdate ();
+    render_size = size;
 
-                break;
-            case 0xb:
-                via_acr = data;
-                break;
-            case 0xc:
-                via_pcr = data;
+    return true;
+}
 
+void Vec3XEmulator::VectorMerge() {
+    // join the draw list into polylines, in drawing order
+    vector_strip_t *strip;
+    vector_point_t *tail;
+    unsigned short x0, y0;
+    unsigned short x1, y1;
+    unsigned char color;
+    long long ax, ay;
+    long long bx, by;
+    long v;
+
+    strip_cnt = 0;
+    strip_point_cnt = 0;
+    strip = NULL;
+
+    for (v = 0; v < vector_draw_cnt; v++) {
+        x0 = vectors_draw.x0[v];
+        y0 = vectors_draw.y0[v];
+        x1 = vectors_draw.x1[v];
+        y1 = vectors_draw.y1[v];
+        color = vectors_draw.color[v];
+        tail = strip != NULL ? &strip_points[strip_point_cnt - 1] : NULL;
+
+        /* a vector starting where the current strip ends with the same
+         * intensity continues the strip. only neighbours in the draw list
+         * are joined, so overlapping lines keep their drawing order.
+         */
 
-                if ((via_pcr & 0x0e) == 0x0c) {
-                    /* ca2 is outputting low */
+        if (tail != NULL && strip->color == color &&
+            tail->x == x0 && tail->y == y0) {
 
-                    via_ca2 = 0;
-                } else {
-                    /* ca2 is disabled or in pulse mode or is
-                     * outputting high.
-                     */
+            ax = (long long) tail->x - tail[-1].x;
+            ay = (long long) tail->y - tail[-1].y;
+            bx = (long long) x1 - x0;
+            by = (long long) y1 - y0;
 
-                    via_ca2 = 1;
+            /* a collinear segment that does not turn back just moves the
+             * end point, this also swallows zero length vectors.
+             */
+
+            if (ax * by == ay * bx && ax * bx + ay * by >= 0) {
+                if (bx != 0 || by != 0) {
+                    tail->x = x1;
+                    tail->y = y1;
                 }
+            } else {
+                strip_points[strip_point_cnt].x = x1;
+                strip_points[strip_point_cnt].y = y1;
+                strip_point_cnt++;
+                strip->count++;
+            }
 
-                if ((via_pcr & 0xe0) == 0xc0) {
-                    /* cb2 is outputting low */
+            continue;
+        }
 
-                    via_cb2h = 0;
-                } else {
-                    /* cb2 is disabled or is in pulse mode or is
-                     * outputting high.
-                     */
+        strip = &strips[strip_cnt++];
+        strip->first = strip_point_cnt;
+        strip->count = 2;
+        strip->color = color;
 
-                    via_cb2h = 1;
-                }
+        strip_points[strip_point_cnt].x = x0;
+        strip_points[strip_point_cnt].y = y0;
+        strip_points[strip_point_cnt + 1].x = x1;
+        strip_points[strip_point_cnt + 1].y = y1;
+        strip_point_cnt += 2;
+    }
+}
 
-                break;
-            case 0xd:
-                /* interrupt flag register */
+bool Vec3XEmulator::StreamPush(const vector_event_t* event) {
+    // append to the vector stream, never waits for the reader
+    unsigned head = stream_head.load(std::memory_order_relaxed);
 
-                via_ifr &= ~(data & 0x7f);
-                IntUpdate ();
+    if (head - stream_tail.load(std::memory_order_acquire) >= VECTOR_STREAM_SIZE) {
+        stream_dropped++;
+        return false;
+    }
 
-                break;
-            case 0xe:
-                /* interrupt enable register */
+    stream_events[head & (VECTOR_STREAM_SIZE - 1)] = *event;
+    stream_head.store(head + 1, std::memory_order_release);
 
-                if (data & 0x80) {
-                    via_ier |= data & 0x7f;
-                } else {
-                    via_ier &= ~(data & 0x7f);
-                }
+    return true;
+}
 
-                IntUpdate ();
+long Vec3XEmulator::ReadVectorStream(vector_event_t* events, long max) {
+    // take up to max events from the vector stream, from one thread only
+    unsigned tail = stream_tail.load(std::memory_order_relaxed);
+    unsigned head = stream_head.load(std::memory_order_acquire);
+    long count = 0;
 
-                break;
-            }
-        }
-    } else if (address < 0x8000) {
-        /* cartridge */
+    while (tail != head && count < max) {
+        events[count++] = stream_events[tail & (VECTOR_STREAM_SIZE - 1)];
+        tail++;
     }
-}
 
-void Vec3XEmulator::ViaSstep0() {
-    // Perform a single cycle worth of via emulation via_sstep0 is the first postion of the emulation.
-    unsigned t2shift;
+    stream_tail.store(tail, std::memory_order_release);
 
-    if (via_t1on) {
-        via_t1c--;
+    return count;
+}
 
-        if ((via_t1c & 0xffff) == 0xffff) {
-            /* counter just rolled over */
+void Vec3XEmulator::AlgAddline(long x0, long y0, long x1, long y1, unsigned char color) {
+    unsigned long long key;
+    vector_slot_t *slot;
+    vector_slot_t *draw_slot;
+    vector_slot_t *erse_slot;
+    vector_slot_t *free_slot;
+    unsigned char kept;
+    unsigned id;
+    unsigned long size;
+    unsigned long h;
+    unsigned p;
+
+    /* keep the table at most half full with the entries of both lists */
+
+    if ((unsigned long) (vector_draw_cnt + vector_erse_cnt + 1) * 2 > (vector_hash == NULL ? 0 : 1UL << vector_hash_bits)) {
+        VectorHashGrow();
+    }
 
-            if (via_acr & 0x40) {
-                /* continuous interrupt mode */
+    key = (unsigned long long) x0;
+    key = (key << 16) | (unsigned long long) y0;
+    key = (key << 16) | (unsigned long long) x1;
+    key = (key << 16) | (unsigned long long) y1;
 
-                via_ifr |= 0x40;
-                IntUpdate ();
-                via_t1pb7 = 0x80 - via_t1pb7;
+    /* look for the line in every slot of its probe window. entries tagged
+     * with the current generation refer to the draw list, those of the last
+     * frame to the erase list and anything older is free.
+     */
 
-                /* reload counter */
+    draw_slot = NULL;
+    erse_slot = NULL;
+    free_slot = NULL;
 
-                via_t1c = (via_t1lh << 8) | via_t1ll;
-            } else {
-                /* one shot mode */
+    if (vector_hash != NULL) {
+        size = 1UL << vector_hash_bits;
+        h = (unsigned long) ((key * VECTOR_HASH_MUL) >> (64 - vector_hash_bits));
 
-                if (via_t1int) {
-                    via_ifr |= 0x40;
-                    IntUpdate ();
-                    via_t1pb7 = 0x80;
-                    via_t1int = 0;
+        for (p = 0; p < VECTOR_HASH_PROBE; p++) {
+            slot = &vector_hash[(h + p) & (size - 1)];
+
+            if (slot->gen == vector_gen) {
+                if (slot->key == key) {
+                    draw_slot = slot;
+                    break;
+                }
+            } else if (slot->gen + 1 == vector_gen) {
+                if (slot->key == key) {
+                    erse_slot = slot;
                 }
+            } else if (free_slot == NULL) {
+                free_slot = slot;
             }
         }
     }
 
-    if (via_t2on && (via_acr & 0x20) == 0x00) {
-        via_t2c--;
-
-        if ((via_t2c & 0xffff) == 0xffff) {
-            /* one shot mode */
+    /* a line already in the current draw list is not added again */
 
-            if (via_t2int) {
-                via_ifr |= 0x20;
-                IntUpdate ();
-                via_t2int = 0;
-            }
+    if (draw_slot != NULL) {
+        if (vectors_draw.color[draw_slot->index] != color) {
+            vectors_draw.kept[draw_slot->index] = 0;
         }
+
+        vectors_draw.color[draw_slot->index] = color;
+        vector_stats.hits++;
+        return;
     }
 
-    /* shift counter */
+    vector_stats.misses++;
 
-    via_src--;
+    /* the list is bounded by VECTOR_CNT, anything beyond is dropped */
 
-    if ((via_src & 0xff) == 0xff) {
-        via_src = via_t2ll;
+    if (vector_draw_cnt == vector_draw_size && !VectorGrow()) {
+        return;
+    }
 
-        if (via_srclk) {
-            t2shift = 1;
-            via_srclk = 0;
-        } else {
-            t2shift = 0;
-            via_srclk = 1;
-        }
+    /* a line on the erase list is "invalidated" there and its slot and id
+     * taken over by the new entry. if the color is the same, the pixels of
+     * the last frame are still right, see RasterDirty
+     */
+
+    kept = 0;
+    id = vector_id_next;
+
+    if (erse_slot != NULL) {
+        kept = vectors_erse.color[erse_slot->index] == color;
+        id = vectors_erse.id[erse_slot->index];
+        vectors_erse.color[erse_slot->index] = VECTREX_COLORS;
+        free_slot = erse_slot;
+    }
+
+    vectors_draw.x0[vector_draw_cnt] = (unsigned short) x0;
+    vectors_draw.y0[vector_draw_cnt] = (unsigned short) y0;
+    vectors_draw.x1[vector_draw_cnt] = (unsigned short) x1;
+    vectors_draw.y1[vector_draw_cnt] = (unsigned short) y1;
+    vectors_draw.color[vector_draw_cnt] = color;
+    vectors_draw.kept[vector_draw_cnt] = kept;
+    vectors_draw.id[vector_draw_cnt] = id;
+
+    if (erse_slot == NULL) {
+        vector_id_next++;
+    }
+
+    if (_streamVectors) {
+        vector_event_t event;
+
+        event.cycle = alg_cycle;
+        event.frame = _displayFrame + 1;
+        event.type = VECTOR_EVENT_LINE;
+        event.id = id;
+        event.x0 = (int) (_xOffset + x0 / _scaling);
+        event.y0 = (int) (_yOffset + y0 / _scaling);
+        event.x1 = (int) (_xOffset + x1 / _scaling);
+        event.y1 = (int) (_yOffset + y1 / _scaling);
+        event.color = color;
+        event.dropped = 0;
+
+        StreamPush(&event);
+    }
+
+    /* with a full probe window the line is drawn but not tracked */
+
+    if (free_slot != NULL) {
+        free_slot->key = key;
+        free_slot->gen = vector_gen;
+        free_slot->index = (unsigned) vector_draw_cnt;
     } else {
-        t2shift = 0;
+        vector_stats.collisions++;
     }
 
-    if (via_srb < 8) {
-        switch (via_acr & 0x1c) {
-        case 0x00:
-            /* disabled */
-            break;
-        case 0x04:
-            /* shift in under control of t2 */
+    vector_draw_cnt++;
+}
 
-            if (t2shift) {
-                /* shifting in 0s since cb2 is always an output */
+void Vec3XEmulator::AlgSignals(long* sig_dx, long* sig_dy, unsigned* sig_blank) {
+    // beam movement and blanking as seen by the integrators this cycle
+    *sig_blank = alg_blank;
 
-                via_sr <<= 1;
-                via_srb++;
-            }
+    if (via_ca2 == 0) {
+        /* need to force the current point to the 'orgin' so just
+         * calculate distance to origin and use that as dx,dy.
+         */
 
-            break;
-        case 0x08:
-            /* shift in under system clk control */
+        *sig_dx = ALG_MAX_X / 2 - alg_curr_x;
+        *sig_dy = ALG_MAX_Y / 2 - alg_curr_y;
+    } else if (alg_ramp == 0) {
+        *sig_dx = alg_dx;
+        *sig_dy = alg_dy;
+    } else {
+        *sig_dx = 0;
+        *sig_dy = 0;
+    }
+}
 
-            via_sr <<= 1;
-            via_srb++;
+bool Vec3XEmulator::AlgIdle() {
+    // true if AlgSstep would change nothing, which stays so as long as
+    // the via signals do not change
+    long sig_dx, sig_dy;
+    unsigned sig_blank;
+    bool inside;
 
-            break;
-        case 0x0c:
-            /* shift in under cb1 control */
-            break;
-        case 0x10:
-            /* shift out under t2 control (free run) */
+    AlgSignals(&sig_dx, &sig_dy, &sig_blank);
 
-            if (t2shift) {
-                via_cb2s = (via_sr >> 7) & 1;
+    if (sig_dx != 0 || sig_dy != 0) {
+        return false;
+    }
 
-                via_sr <<= 1;
-                via_sr |= via_cb2s;
-            }
+    inside = alg_curr_x >= 0 && alg_curr_x < ALG_MAX_X &&
+             alg_curr_y >= 0 && alg_curr_y < ALG_MAX_Y;
 
-            break;
-        case 0x14:
-            /* shift out under t2 control */
+    if (alg_vectoring == 0) {
+        /* a vector would start */
 
-            if (t2shift) {
-                via_cb2s = (via_sr >> 7) & 1;
+        return !(sig_blank == 1 && inside);
+    }
 
-                via_sr <<= 1;
-                via_sr |= via_cb2s;
-                via_srb++;
-            }
+    /* the vector neither ends nor grows */
 
-            break;
-        case 0x18:
-            /* shift out under system clock control */
+    return sig_blank == 1 &&
+           alg_vector_dx == 0 && alg_vector_dy == 0 &&
+           (unsigned char) alg_zsh == alg_vector_color &&
+           (!inside || (alg_vector_x1 == alg_curr_x && alg_vector_y1 == alg_curr_y));
+}
 
-            via_cb2s = (via_sr >> 7) & 1;
+void Vec3XEmulator::AlgSpan(long sig_dx, long sig_dy, long* first, long* last) {
+    // narrow first..last to the steps k for which the beam moved k times
+    // is inside the screen, these form one range as the beam moves straight
+    AlgSpanAxis(alg_curr_x, sig_dx, ALG_MAX_X, first, last);
+    AlgSpanAxis(alg_curr_y, sig_dy, ALG_MAX_Y, first, last);
+}
 
-            via_sr <<= 1;
-            via_sr |= via_cb2s;
-            via_srb++;
+void Vec3XEmulator::AlgSpanAxis(long pos, long delta, long max, long* first, long* last) {
+    long k0, k1;
 
-            break;
-        case 0x1c:
-            /* shift out under cb1 control */
-            break;
+    if (delta == 0) {
+        if (pos < 0 || pos >= max) {
+            *first = *last + 1;
         }
 
-        if (via_srb == 8) {
-            via_ifr |= 0x04;
-            IntUpdate ();
-        }
+        return;
+    }
+
+    if (delta > 0) {
+        k0 = DivCeil(-pos, delta);
+        k1 = DivFloor(max - 1 - pos, delta);
+    } else {
+        k0 = DivCeil(max - 1 - pos, delta);
+        k1 = DivFloor(-pos, delta);
+    }
+
+    if (k0 > *first) {
+        *first = k0;
+    }
+
+    if (k1 < *last) {
+        *last = k1;
     }
 }
 
-void Vec3XEmulator::ViaSstep1() {
-    // perform the second part of the via emulation
-    if ((via_pcr & 0x0e) == 0x0a) {
-        /* if ca2 is in pulse mode, then make sure
-         * it gets restored to '1' after the pulse.
-         */
+long Vec3XEmulator::DivFloor(long a, long b) {
+    long q = a / b;
 
-        via_ca2 = 1;
+    if ((a % b) != 0 && ((a < 0) != (b < 0))) {
+        q--;
     }
 
-    if ((via_pcr & 0xe0) == 0xa0) {
-        /* if cb2 is in pulse mode, then make sure
-         * it gets restored to '1' after the pulse.
-         */
+    return q;
+}
 
-        via_cb2h = 1;
+long Vec3XEmulator::DivCeil(long a, long b) {
+    return -DivFloor(-a, b);
+}
+
+long long Vec3XEmulator::DivFloor(long long a, long long b) {
+    long long q = a / b;
+
+    if ((a % b) != 0 && ((a < 0) != (b < 0))) {
+        q--;
     }
+
+    return q;
 }
 
-void Vec3XEmulator::AlgAddline(long x0, long y0, long x1, long y1, unsigned char color) {
-    unsigned long key;
-    long index;
+long long Vec3XEmulator::DivCeil(long long a, long long b) {
+    return -DivFloor(-a, b);
+}
 
-    key = (unsigned long) x0;
-    key = key * 31 + (unsigned long) y0;
-    key = key * 31 + (unsigned long) x1;
-    key = key * 31 + (unsigned long) y1;
-    key %= VECTOR_HASH;
+void Vec3XEmulator::AlgRun(unsigned cycles) {
+    // analog emulation for a number of cycles in which the via signals do
+    // not change. while the ramp moves the beam its position is integrated
+    // over the whole span, only the cycles in which a vector starts or ends
+    // are stepped. the lines passed to AlgAddline are the same as with
+    // stepping every cycle.
+    long sig_dx, sig_dy, first, last;
+    unsigned sig_blank;
+    unsigned long long end = alg_cycle + cycles;
 
-    /* first check if the line to be drawn is in the current draw list.
-     * if it is, then it is not added again.
-     */
+    while (cycles > 0 && !AlgIdle()) {
+        AlgSignals(&sig_dx, &sig_dy, &sig_blank);
 
-    index = vector_hash[key];
+        if (via_ca2 != 0 && (sig_dx != 0 || sig_dy != 0)) {
+            if (sig_blank == 0 && alg_vectoring == 0) {
+                /* blanked, the beam only moves */
 
-    if (index >= 0 && index < vector_draw_cnt &&
-        x0 == vectors_draw[index].x0 &&
-        y0 == vectors_draw[index].y0 &&
-        x1 == vectors_draw[index].x1 &&
-        y1 == vectors_draw[index].y1) {
-        vectors_draw[index].color = color;
-    } else {
-        /* missed on the draw list, now check if the line to be drawn is in
-         * the erase list ... if it is, "invalidate" it on the erase list.
-         */
+                alg_curr_x += sig_dx * (long) cycles;
+                alg_curr_y += sig_dy * (long) cycles;
+
+                return;
+            }
+
+            if (sig_blank == 1 && alg_vectoring == 1 &&
+                sig_dx == alg_vector_dx && sig_dy == alg_vector_dy &&
+                (unsigned char) alg_zsh == alg_vector_color) {
+                /* drawing, the vector is extended up to the last position
+                 * still inside the screen.
+                 */
+
+                first = 1;
+                last = (long) cycles;
+                AlgSpan(sig_dx, sig_dy, &first, &last);
+
+                if (first <= last) {
+                    alg_vector_x1 = alg_curr_x + sig_dx * last;
+                    alg_vector_y1 = alg_curr_y + sig_dy * last;
+                }
 
-        if (index >= 0 && index < vector_erse_cnt &&
-            x0 == vectors_erse[index].x0 &&
-            y0 == vectors_erse[index].y0 &&
-            x1 == vectors_erse[index].x1 &&
-            y1 == vectors_erse[index].y1) {
-            vectors_erse[index].color = VECTREX_COLORS;
+                alg_curr_x += sig_dx * (long) cycles;
+                alg_curr_y += sig_dy * (long) cycles;
+
+                return;
+            }
+
+            if (sig_blank == 1 && alg_vectoring == 0) {
+                /* unblanked, a vector starts once the beam is inside */
+
+                first = 0;
+                last = (long) cycles - 1;
+                AlgSpan(sig_dx, sig_dy, &first, &last);
+
+                if (first > last) {
+                    alg_curr_x += sig_dx * (long) cycles;
+                    alg_curr_y += sig_dy * (long) cycles;
+
+                    return;
+                }
+
+                alg_curr_x += sig_dx * first;
+                alg_curr_y += sig_dy * first;
+                cycles -= (unsigned) first;
+            }
         }
 
-        vectors_draw[vector_draw_cnt].x0 = x0;
-        vectors_draw[vector_draw_cnt].y0 = y0;
-        vectors_draw[vector_draw_cnt].x1 = x1;
-        vectors_draw[vector_draw_cnt].y1 = y1;
-        vectors_draw[vector_draw_cnt].color = color;
-        vector_hash[key] = vector_draw_cnt;
-        vector_draw_cnt++;
+        /* the beam returns to the origin or a vector starts or ends */
+
+        alg_cycle = end - cycles;
+        AlgSstep();
+        cycles--;
     }
 }
 
 void Vec3XEmulator::AlgSstep() {
     // perform a single cycle worth of analog emulation
     long sig_dx, sig_dy;
-    unsigned sig_ramp;
     unsigned sig_blank;
 
-    if ((via_acr & 0x10) == 0x10) {
-        sig_blank = via_cb2s;
-    } else {
-        sig_blank = via_cb2h;
-    }
-
-    if (via_ca2 == 0) {
-        /* need to force the current point to the 'orgin' so just
-         * calculate distance to origin and use that as dx,dy.
-         */
-
-        sig_dx = ALG_MAX_X / 2 - alg_curr_x;
-        sig_dy = ALG_MAX_Y / 2 - alg_curr_y;
-    } else {
-        if (via_acr & 0x80) {
-            sig_ramp = via_t1pb7;
-        } else {
-            sig_ramp = via_orb & 0x80;
-        }
-
-        if (sig_ramp == 0) {
-            sig_dx = alg_dx;
-            sig_dy = alg_dy;
-        } else {
-            sig_dx = 0;
-            sig_dy = 0;
-        }
-    }
+    AlgSignals(&sig_dx, &sig_dy, &sig_blank);
 
     if (alg_vectoring == 0) {
         if (sig_blank == 1 &&
@@ -1173,6 +3122,18 @@ void vectrex_emulator_debug_command(int command, int parameter) {
     vec3x->Command(command, parameter);
 }
 
+void vectrex_emulator_pixel_format(int format) {
+    vec3x->SetPixelFormat(format);
+}
+
+const byte* vectrex_emulator_pixels(int format) {
+    return vec3x->GetPixels(format);
+}
+
+long vectrex_emulator_read_stream(vector_event_t* events, long max) {
+    return vec3x->ReadVectorStream(events, max);
+}
+
 unsigned vectrex_get_register(int reg) {
     return vec3x->GetCPU().GetRegister(reg);
 }
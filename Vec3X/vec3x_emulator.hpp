@@ -1,6 +1,12 @@
 
 #pragma once
 
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
 #include "vec3x_emulator_types.hpp"
 #include "vec3x_emulator_8910.hpp"
 #include "vec3x_emulator_6809.hpp"
@@ -10,6 +16,7 @@ class Vec3XEmulator {
 
 public:
     Vec3XEmulator();
+    ~Vec3XEmulator();
 
 // Emulation
 public:
@@ -23,36 +30,81 @@ public:
     void Command(int command, int parameter);
 
     Vec3XEmulator6809& GetCPU() { return ic6809;}
+    const vector_stats_t& GetVectorStats() const { return vector_stats; }
+    void SetPixelFormat(int format) { _pixelFormat = format; }
+    const byte* GetPixels(int format);
+    long ReadVectorStream(vector_event_t* events, long max);
     
 // Drawing
 private:
     void CreateBuffer(long width, long height);
-    void FastClearBuffer(Uint8 color);
     void ClearBuffer(Uint8 color);
+    void ClearRect(const raster_rect_t* rect);
     void SetPixel(int x, int y, Uint8 color);
-    void DrawLine(int x1, int y1, int x2, int y2, Uint8 color);
+    void DrawLine(int x1, int y1, int x2, int y2, Uint8 color, const raster_rect_t* clip);
+    void DrawLineDDA(int x1, int y1, int x2, int y2, Uint8 color);
+    void DrawLineWu(int x1, int y1, int x2, int y2, Uint8 color, const raster_rect_t* clip);
+    void ConvertPixels(int format);
+    void PhosphorDecay();
+    void RasterLine(const int* screen, Uint8 color, const raster_rect_t* clip);
+    void RasterList(const display_list_t* list, const raster_rect_t* clip);
+    long RasterMark(const vector_list_t* list, long v, long cols);
+    bool RasterDirty();
+    void RasterThreads(int count);
+    void RasterWorker(unsigned gen);
+    void RasterBinLine(const int* screen, Uint8 color, bool fill);
+    bool RasterBin(const display_list_t* list);
+    void RasterBands();
+    void RasterParallel(const display_list_t* list);
+    void RasterBenchmark();
+    void TransformVectors(const vector_list_t* list, long count, int* screen);
+    void TransformPoints(const vector_point_t* points, long count, int* screen);
+    unsigned long long VectorListHash(const vector_list_t* list, long count);
     void Render();
 
 // Helper
 private:
     void LoadFile(const char* romfile, const char* romName, const char* cartfile, const char* cartName);
+    void MapMemory();
     void ResizeScreen(int width, int height);
     
 // Internal
 private:
     void Reset();
-    void Emulate(long cycles);
+    long Emulate(long cycles, bool untilFrame);
 
 // Intrenal bus hnadling
 private:
     void SndUpdate();
     void AlgUpdate();
     void IntUpdate();
+    void SigUpdate();
+    void BankUpdate();
     unsigned char Read8(unsigned address);
     void Write8(unsigned address, unsigned char data);
     void ViaSstep0();
     void ViaSstep1();
+    void ViaSync(unsigned cycles);
+    void ViaSkip(unsigned cycles);
+    long ViaEventCycles(unsigned flags);
+    long ViaEventCycle();
+    long ViaIrqCycles();
+    bool VectorGrow();
+    bool VectorHashGrow();
+    void VectorMerge();
+    bool RenderGrow(long vectors);
+    void VectorHashAge(unsigned frames);
+    bool StreamPush(const vector_event_t* event);
     void AlgAddline(long x0, long y0, long x1, long y1, unsigned char color);
+    void AlgSignals(long* sig_dx, long* sig_dy, unsigned* sig_blank);
+    bool AlgIdle();
+    void AlgSpan(long sig_dx, long sig_dy, long* first, long* last);
+    void AlgSpanAxis(long pos, long delta, long max, long* first, long* last);
+    void AlgRun(unsigned cycles);
+    static long DivFloor(long a, long b);
+    static long DivCeil(long a, long b);
+    static long long DivFloor(long long a, long long b);
+    static long long DivCeil(long long a, long long b);
     void AlgSstep();
 
 private:
@@ -60,7 +112,13 @@ private:
     Vec3XEmulator8910 ic8910;
 
 private:
-    byte* _pixelBuffer = NULL;
+    Uint8* _intensityBuffer = NULL;     // the raster target, one byte per pixel with a one pixel border
+    Uint8* _phosphorBuffer = NULL;      // faded sum of the intensity buffers, see PhosphorDecay
+    byte* _pixelBuffer = NULL;          // converted on demand, see GetPixels
+    int _pixelFormat = PIXEL_FORMAT_NONE;           // passed to vectrex_render_frame, none unless asked for
+    int _pixelBufferFormat = PIXEL_FORMAT_NONE;     // held by _pixelBuffer, none if stale
+    unsigned long _pixelBufferFrame = 0;            // _imageFrame converted into _pixelBuffer
+    unsigned long _imageFrame = 0;                  // last _displayFrame that changed the raster output
 
     long _scaling = 0;
     long _xOffset = 0;
@@ -70,12 +128,33 @@ private:
     bool _isInitialised = false;
     bool _liveUpdate = false;
     bool _paused = false;
+    bool _mergeVectors = false;
+    bool _antialias = false;
+    bool _incrementalRaster = false;
+    bool _streamVectors = false;
+    bool _frameSync = false;            // refresh on the game frame boundary, see Emulate
+    unsigned _phosphorDecay = 0;        // brightness kept per refresh in 1/256, 0 turns persistence off
+    bool _rasterValid = false;          // the intensity buffer shows the erase list, see RasterDirty
+    unsigned long _displayFrame = 0;    // sequence number of the last display list
+    unsigned long _displayChanged = 0;  // last frame with a new hash, 0 forces the next one to differ
+    unsigned long long _displayHash = 0;
     
 private:
     unsigned char _rom[8192];
-    unsigned char _cartridge[32768];
+    unsigned char _cartridge[CARTRIDGE_MAX_BANKS * CARTRIDGE_BANK_SIZE];
     unsigned char _ram[1024];
 
+    unsigned _cartridgeBanks = 1;           // number of 32k banks in the loaded cartridge
+    unsigned char* _cartridgeBank = NULL;   // bank currently mapped to 0x0000-0x7fff
+
+    // memory map used by the cpu, one entry per 256 byte page. NULL
+    // means the page has side effects (via) and goes through Read8/Write8
+    const unsigned char* _readMap[MEMORY_PAGES];
+    unsigned char* _writeMap[MEMORY_PAGES];
+    unsigned char _openBus[MEMORY_PAGE_SIZE];   // unmapped pages read 0xff
+    unsigned char _zeroPage[MEMORY_PAGE_SIZE];  // 0xc000-0xc7ff reads 0
+    unsigned char _sinkPage[MEMORY_PAGE_SIZE];  // writes to rom and cartridge are dropped
+
     // sound chip registers
     unsigned _soundRegisters[16];
     unsigned _soundSelect;
@@ -119,6 +198,10 @@ private:
     unsigned alg_jsh;   // joystick sample and hold
 
     unsigned alg_compare;
+    unsigned long long alg_cycle;   // cycle of the current AlgSstep, see ViaSync
+
+    unsigned alg_blank; // blank signal from cb2, see SigUpdate
+    unsigned alg_ramp;  // ramp signal from pb7 or timer 1, active low
 
     long alg_dx;     // delta x
     long alg_dy;     // delta y
@@ -134,12 +217,80 @@ private:
     long alg_vector_dy;
     unsigned char alg_vector_color;
 
+    // the draw and erase lists swap every frame. both grow on demand and
+    // keep their allocation across frames and resets
     long vector_draw_cnt;
     long vector_erse_cnt;
-    vector_t vectors_set[2 * VECTOR_CNT];
-    vector_t *vectors_draw;
-    vector_t *vectors_erse;
-    long vector_hash[VECTOR_HASH];
+    long vector_draw_size = 0;
+    long vector_erse_size = 0;
+    vector_list_t vectors_draw = {};
+    vector_list_t vectors_erse = {};
+
+    // open addressing table over both lists, see AlgAddline. a slot belongs
+    // to the draw list if tagged with vector_gen, to the erase list if one
+    // generation older and is free otherwise. vector_gen advances every
+    // frame, so the table never needs clearing
+    vector_slot_t *vector_hash = NULL;
+    unsigned vector_hash_bits = 0;
+    unsigned vector_gen = 2;
+    vector_stats_t vector_stats = {};
+
+    // ids are handed out in order, those from vector_id_base on are new
+    // in the current draw list
+    unsigned vector_id_next = 0;
+    unsigned vector_id_base = 0;
+
+    // buffers of Render, sized for render_size vectors. the polylines
+    // built by VectorMerge take up to twice as many points, render_screen
+    // holds four screen coordinates per vector, or two per strip point.
+    // render_added and render_removed hold the id changes of a frame
+    long render_size = 0;
+    long strip_cnt;
+    long strip_point_cnt;
+    vector_strip_t *strips = NULL;
+    vector_point_t *strip_points = NULL;
+    int *render_screen = NULL;
+    unsigned *render_added = NULL;
+    unsigned *render_removed = NULL;
+
+    // tiles of the incremental raster, one byte each, and the rectangles
+    // RasterDirty merged them into
+    Uint8 *raster_dirty = NULL;
+    long raster_rect_cnt;
+    raster_rect_t raster_rects[RASTER_RECTS_MAX];
+
+    // workers of RasterParallel, they sleep on raster_wake until raster_gen
+    // changes and take bands from raster_band_job until all are drawn
+    std::vector<std::thread> raster_threads;
+    std::mutex raster_lock;
+    std::condition_variable raster_wake;
+    std::condition_variable raster_done;
+    unsigned raster_gen = 0;
+    int raster_busy = 0;                    // workers still drawing
+    bool raster_quit = false;
+    std::atomic<long> raster_band_job;
+
+    // lines binned by RasterBin, those of band b are raster_band_lines
+    // from raster_band_first[b] up to raster_band_first[b + 1]
+    long raster_band_cnt;
+    long raster_band_size = 0;
+    long *raster_band_first = NULL;
+    long *raster_band_next = NULL;
+    long raster_line_size = 0;
+    raster_line_t *raster_band_lines = NULL;
 
     long fcycles;
+    bool frame_sync_due = false;        // the game reloaded timer 2 after it ran out
+    long frame_carry = 0;               // cycles Frame owes the next call, see DEBUG_FRAME_SYNC
+    unsigned _syncCycles = 0;   // cycles of the current cpu run the via has already stepped
+    unsigned long long _cycles = 0;     // cycles emulated before the current cpu run
+
+    // single producer, single consumer ring of vector events. the emulation
+    // thread writes at stream_head, any one other thread reads at
+    // stream_tail. events that do not fit are dropped. the VECTOR_STREAM_SIZE
+    // entries are allocated when streaming is first turned on and kept
+    std::atomic<unsigned> stream_head{0};
+    std::atomic<unsigned> stream_tail{0};
+    unsigned long stream_dropped = 0;   // since the last frame event that got through
+    vector_event_t *stream_events = NULL;
 };
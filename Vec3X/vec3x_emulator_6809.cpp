@@ -7,18 +7,144 @@ extern "C" {
     void platform_print(const char *message);
 }
 
+/* opcode dispatch. the decoder resolves the page prefix (page 1 is
+ * prefixed by 0x10 and page 2 by 0x11) into the handler index of the
+ * instruction, see decode_inst. with gcc/clang the handler table holds label
+ * addresses and the handlers are entered with a computed goto, other
+ * compilers fall back to a plain switch on the index.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VEC3X_THREADED_DISPATCH 1
+#endif
+
+/* end of an instruction. the run goes on with the next instruction until
+ * it reaches its cycle limit, an i/o access stopped it or an interrupt is
+ * pending, then Step returns. while the code runs straight on, the next
+ * instruction is the cache entry right behind the current one, only after
+ * a branch, at the end of a cache page or in ram it is looked up again.
+ * threaded handlers fetch and enter the next instruction themselves, the
+ * switch goes back to a single fetch.
+ */
+
+#define STEP_CHECK              run_cycles = cycles; \
+                                if (cycles >= limit || run_stop != 0 || (irq_wait & ~reg_cc) != 0) { \
+                                    goto step_done; \
+                                }
+
+#define STEP_FETCH              if (inst->next != 0 && reg_pc == pc + inst->next) { \
+                                    inst = decode_next (inst, reg_pc); \
+                                } else { \
+                                    inst = decode (reg_pc); \
+                                }
+
+#define STEP_ENTER              pc = reg_pc; \
+                                current = inst; \
+                                reg_pc += inst->length; \
+                                cycles += inst->cycles; \
+                                op = inst->handler;
+
+/* first handler index of every opcode page */
+
 enum {
-    FLAG_E      = 0x80,
-    FLAG_F      = 0x40,
-    FLAG_H      = 0x20,
-    FLAG_I      = 0x10,
-    FLAG_N      = 0x08,
-    FLAG_Z      = 0x04,
-    FLAG_V      = 0x02,
-    FLAG_C      = 0x01,
-    IRQ_NORMAL  = 0,
-    IRQ_SYNC    = 1,
-    IRQ_CWAI    = 2
+    page0_handlers = 0 * HANDLER_PAGE_SIZE,
+    page1_handlers = 1 * HANDLER_PAGE_SIZE,
+    page2_handlers = 2 * HANDLER_PAGE_SIZE
+};
+
+#ifdef VEC3X_THREADED_DISPATCH
+#define DISPATCH                goto *step_table[op];
+#define OPCODE(page, code)      page##_##code:
+#define ILLEGAL_OPCODE(page)    page##_illegal:
+#define END_DISPATCH
+#define NEXT                    do { STEP_CHECK STEP_FETCH STEP_ENTER DISPATCH } while (0)
+#else
+#define DISPATCH                switch (op) {
+#define OPCODE(page, code)      case page##_handlers + 0x##code:
+#define ILLEGAL_OPCODE(page)    case HANDLER_ILLEGAL + page##_handlers / HANDLER_PAGE_SIZE:
+#define END_DISPATCH            }
+#define NEXT                    goto step_next
+#endif
+
+/* end of a relative branch, a short one back may close a wait loop */
+
+#define NEXT_BRANCH             if (reg_pc < pc || pc == loop_branch) { \
+                                    cycles = loop_check (pc, cycles, limit); \
+                                } \
+                                NEXT
+
+/* kind of the last instruction with deferred condition codes */
+
+enum {
+    CC_TST8,
+    CC_TST16,
+    CC_ADD8,
+    CC_SUB8,
+    CC_ADD16,
+    CC_SUB16
+};
+
+/* base cycle count of every instruction, the only place the interpreter
+ * and the decode cache take them from. additional
+ * cycles for indexed addressing, taken long branches and register stacking
+ * are added by the instruction itself.
+ */
+
+static constexpr unsigned char page0_cycles[256] = {
+     6,  0,  0,  6,  6,  0,  6,  6,  6,  6,  6,  0,  6,  6,  3,  6,
+     0,  0,  2,  2,  0,  0,  5,  9,  0,  2,  3,  0,  3,  2,  8,  6,
+     3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,
+     4,  4,  4,  4,  5,  5,  5,  5,  0,  5,  3,  3,  4, 11,  0,  7,
+     2,  0,  0,  2,  2,  0,  2,  2,  2,  2,  2,  0,  2,  2,  0,  2,
+     2,  0,  0,  2,  2,  0,  2,  2,  2,  2,  2,  0,  2,  2,  0,  2,
+     6,  0,  0,  6,  6,  0,  6,  6,  6,  6,  6,  0,  6,  6,  3,  6,
+     7,  0,  0,  7,  7,  0,  7,  7,  7,  7,  7,  0,  7,  7,  4,  7,
+     2,  2,  2,  4,  2,  2,  2,  0,  2,  2,  2,  2,  4,  7,  3,  0,
+     4,  4,  4,  6,  4,  4,  4,  4,  4,  4,  4,  4,  6,  7,  5,  5,
+     4,  4,  4,  6,  4,  4,  4,  4,  4,  4,  4,  4,  6,  7,  5,  5,
+     5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  5,  7,  8,  6,  6,
+     2,  2,  2,  4,  2,  2,  2,  0,  2,  2,  2,  2,  3,  0,  3,  0,
+     4,  4,  4,  6,  4,  4,  4,  4,  4,  4,  4,  4,  5,  5,  5,  5,
+     4,  4,  4,  6,  4,  4,  4,  4,  4,  4,  4,  4,  5,  5,  5,  5,
+     5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  5,  6,  6,  6,  6
+};
+
+static constexpr unsigned char page1_cycles[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  8,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  5,  0,  0,  0,  0,  0,  0,  0,  0,  5,  0,  4,  0,
+     0,  0,  0,  7,  0,  0,  0,  0,  0,  0,  0,  0,  7,  0,  6,  6,
+     0,  0,  0,  7,  0,  0,  0,  0,  0,  0,  0,  0,  7,  0,  6,  6,
+     0,  0,  0,  8,  0,  0,  0,  0,  0,  0,  0,  0,  8,  0,  7,  7,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  6,  6,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  6,  6,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  7,  7
+};
+
+static constexpr unsigned char page2_cycles[256] = {
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  8,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  5,  0,  0,  0,  0,  0,  0,  0,  0,  5,  0,  0,  0,
+     0,  0,  0,  7,  0,  0,  0,  0,  0,  0,  0,  0,  7,  0,  0,  0,
+     0,  0,  0,  7,  0,  0,  0,  0,  0,  0,  0,  0,  7,  0,  0,  0,
+     0,  0,  0,  8,  0,  0,  0,  0,  0,  0,  0,  0,  8,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
 };
 
 Vec3XEmulator6809::Vec3XEmulator6809(Vec3XEmulator* emulator) {
@@ -30,6 +156,12 @@ Vec3XEmulator6809::Vec3XEmulator6809(Vec3XEmulator* emulator) {
     rptr_xyus[3] = &reg_s;
 }
 
+Vec3XEmulator6809::~Vec3XEmulator6809() {
+    for (int page = 0; page < DECODE_PAGES; page++) {
+        free(decode_pages[page]);
+    }
+}
+
 #pragma mark - Helper method
 
 unsigned Vec3XEmulator6809::GetRegister(int reg) {
@@ -51,7 +183,7 @@ unsigned Vec3XEmulator6809::GetRegister(int reg) {
         case VECTREX_REG_DP:
             return reg_dp;
         case VECTREX_REG_CC:
-            return reg_cc;
+            return get_reg_cc ();
     }
     
     return 0;
@@ -59,10 +191,16 @@ unsigned Vec3XEmulator6809::GetRegister(int reg) {
 
 #pragma mark - Instructions
 
-/* obtain a particular condition code. returns 0 or 1. */
+/* obtain a particular condition code. returns 0 or 1. a flag still
+ * owed by the last arithmetic instruction is computed first.
+ */
 
 unsigned Vec3XEmulator6809::get_cc (unsigned flag)
 {
+    if (cc_mask & flag) {
+        cc_update (flag);
+    }
+
     return (reg_cc / flag) & 1;
 }
 
@@ -72,10 +210,78 @@ unsigned Vec3XEmulator6809::get_cc (unsigned flag)
 
 void Vec3XEmulator6809::set_cc (unsigned flag, unsigned value)
 {
+    cc_mask &= ~flag;
+
     reg_cc &= ~flag;
     reg_cc |= value * flag;
 }
 
+/* lazy condition codes. the arithmetic instructions only record their
+ * inputs and result together with the flags they affect, the flags are
+ * computed when somebody asks for them. most of them are overwritten by
+ * the next instruction before that happens.
+ */
+
+void Vec3XEmulator6809::cc_defer (unsigned kind, unsigned mask,
+                                  unsigned i0, unsigned i1, unsigned r)
+{
+    /* flags of the previous instruction not covered by this one */
+
+    if (cc_mask & ~mask) {
+        cc_update (cc_mask & ~mask);
+    }
+
+    cc_kind = kind;
+    cc_mask = mask;
+    cc_i0 = i0;
+    cc_i1 = i1;
+    cc_r = r;
+}
+
+/* compute the deferred flags in mask and store them in reg_cc */
+
+void Vec3XEmulator6809::cc_update (unsigned mask)
+{
+    unsigned i0, i1, r, flags;
+
+    i0 = cc_i0;
+    i1 = cc_i1;
+    r = cc_r;
+
+    /* tst leaves v cleared */
+
+    switch (cc_kind) {
+    case CC_TST8:
+        flags  = test_n (r) * FLAG_N;
+        flags |= test_z8 (r) * FLAG_Z;
+        break;
+    case CC_TST16:
+        flags  = test_n (r >> 8) * FLAG_N;
+        flags |= test_z16 (r) * FLAG_Z;
+        break;
+    case CC_ADD8:
+    case CC_SUB8:
+        flags  = test_c (i0 << 4, i1 << 4, r << 4, 0) * FLAG_H;
+        flags |= test_n (r) * FLAG_N;
+        flags |= test_z8 (r) * FLAG_Z;
+        flags |= test_v (i0, i1, r) * FLAG_V;
+        flags |= test_c (i0, i1, r, cc_kind == CC_SUB8) * FLAG_C;
+        break;
+    default:
+        i0 >>= 8;
+        i1 >>= 8;
+
+        flags  = test_n (r >> 8) * FLAG_N;
+        flags |= test_z16 (r) * FLAG_Z;
+        flags |= test_v (i0, i1, r >> 8) * FLAG_V;
+        flags |= test_c (i0, i1, r >> 8, cc_kind == CC_SUB16) * FLAG_C;
+        break;
+    }
+
+    reg_cc = (reg_cc & ~mask) | (flags & mask);
+    cc_mask &= ~mask;
+}
+
 /* test carry */
 
 unsigned Vec3XEmulator6809::test_c (unsigned i0, unsigned i1,
@@ -154,13 +360,40 @@ void Vec3XEmulator6809::set_reg_d (unsigned value)
     reg_b = value;
 }
 
+/* the whole condition code register, with all deferred flags */
+
+unsigned Vec3XEmulator6809::get_reg_cc (void)
+{
+    if (cc_mask) {
+        cc_update (cc_mask);
+    }
+
+    return reg_cc;
+}
+
+void Vec3XEmulator6809::set_reg_cc (unsigned value)
+{
+    cc_mask = 0;
+    reg_cc = value;
+}
+
 /* read a byte ... the returned value has the lower 8-bits set to the byte
- * while the upper bits are all zero.
+ * while the upper bits are all zero. plain memory is read straight from the
+ * page table, only the via goes through the bus.
  */
 
 unsigned Vec3XEmulator6809::read8 (unsigned address)
 {
-    return vectrex->Read8(address & 0xffff);
+    const unsigned char *page;
+
+    address &= 0xffff;
+    page = vectrex->_readMap[address >> 8];
+
+    if (page != NULL) {
+        return page[address & 0xff];
+    }
+
+    return vectrex->Read8(address);
 }
 
 /* write a byte ... only the lower 8-bits of the unsigned data
@@ -169,13 +402,35 @@ unsigned Vec3XEmulator6809::read8 (unsigned address)
 
 void Vec3XEmulator6809::write8 (unsigned address, unsigned data)
 {
-    vectrex->Write8(address & 0xffff, (unsigned char) data);
+    unsigned char *page;
+
+    address &= 0xffff;
+    page = vectrex->_writeMap[address >> 8];
+
+    if (page != NULL) {
+        page[address & 0xff] = (unsigned char) data;
+        return;
+    }
+
+    vectrex->Write8(address, (unsigned char) data);
 }
 
+/* 16-bit accesses within one page are done with a single lookup */
+
 unsigned Vec3XEmulator6809::read16 (unsigned address)
 {
+    const unsigned char *page;
     unsigned datahi, datalo;
 
+    address &= 0xffff;
+    page = vectrex->_readMap[address >> 8];
+
+    if (page != NULL && (address & 0xff) != 0xff) {
+        page += address & 0xff;
+
+        return (page[0] << 8) | page[1];
+    }
+
     datahi = read8 (address);
     datalo = read8 (address + 1);
 
@@ -184,6 +439,18 @@ unsigned Vec3XEmulator6809::read16 (unsigned address)
 
 void Vec3XEmulator6809::write16 (unsigned address, unsigned data)
 {
+    unsigned char *page;
+
+    address &= 0xffff;
+    page = vectrex->_writeMap[address >> 8];
+
+    if (page != NULL && (address & 0xff) != 0xff) {
+        page += address & 0xff;
+        page[0] = (unsigned char) (data >> 8);
+        page[1] = (unsigned char) data;
+        return;
+    }
+
     write8 (address, data >> 8);
     write8 (address + 1, data);
 }
@@ -206,13 +473,38 @@ unsigned Vec3XEmulator6809::pull8 (unsigned *sp)
 
 void Vec3XEmulator6809::push16 (unsigned *sp, unsigned data)
 {
+    unsigned char *page;
+    unsigned address;
+
+    address = (*sp - 2) & 0xffff;
+    page = vectrex->_writeMap[address >> 8];
+
+    if (page != NULL && (address & 0xff) != 0xff) {
+        *sp -= 2;
+        page += address & 0xff;
+        page[0] = (unsigned char) (data >> 8);
+        page[1] = (unsigned char) data;
+        return;
+    }
+
     push8 (sp, data);
     push8 (sp, data >> 8);
 }
 
 unsigned Vec3XEmulator6809::pull16 (unsigned *sp)
 {
-    unsigned datahi, datalo;
+    const unsigned char *page;
+    unsigned address, datahi, datalo;
+
+    address = *sp & 0xffff;
+    page = vectrex->_readMap[address >> 8];
+
+    if (page != NULL && (address & 0xff) != 0xff) {
+        *sp += 2;
+        page += address & 0xff;
+
+        return (page[0] << 8) | page[1];
+    }
 
     datahi = pull8 (sp);
     datalo = pull8 (sp);
@@ -220,28 +512,246 @@ unsigned Vec3XEmulator6809::pull16 (unsigned *sp)
     return (datahi << 8) | datalo;
 }
 
-/* read a byte from the address pointed to by the pc */
+/* addressing mode of an opcode within its page */
 
-unsigned Vec3XEmulator6809::pc_read8 (void)
+static unsigned opcode_mode (unsigned page, unsigned op)
 {
-    unsigned data;
+    const unsigned char *cycles;
 
-    data = read8 (reg_pc);
-    reg_pc++;
+    if (page == 0 && (op == 0x10 || op == 0x11)) {
+        return MODE_PREFIX;
+    }
 
-    return data;
+    cycles = page == 0 ? page0_cycles : (page == 1 ? page1_cycles : page2_cycles);
+
+    if (cycles[op] == 0) {
+        return MODE_ILLEGAL;
+    }
+
+    switch (op >> 4) {
+    case 0x0:
+    case 0x9:
+    case 0xd:
+        return MODE_DIRECT;
+    case 0x1:
+        if (op == 0x16 || op == 0x17) {
+            return MODE_RELATIVE16;
+        }
+
+        if (op == 0x1a || op == 0x1c || op == 0x1e || op == 0x1f) {
+            return MODE_IMMEDIATE8;
+        }
+
+        return MODE_INHERENT;
+    case 0x2:
+        return page == 0 ? MODE_RELATIVE8 : MODE_RELATIVE16;
+    case 0x3:
+        if (op <= 0x33) {
+            return MODE_INDEXED;
+        }
+
+        if (op <= 0x37 || op == 0x3c) {
+            return MODE_IMMEDIATE8;
+        }
+
+        return MODE_INHERENT;
+    case 0x4:
+    case 0x5:
+        return MODE_INHERENT;
+    case 0x6:
+    case 0xa:
+    case 0xe:
+        return MODE_INDEXED;
+    case 0x8:
+    case 0xc:
+        if (op == 0x8d) {
+            return MODE_RELATIVE8;
+        }
+
+        if ((op & 0xf) == 0x3 || (op & 0xf) == 0xc || (op & 0xf) == 0xe) {
+            return MODE_IMMEDIATE16;
+        }
+
+        return MODE_IMMEDIATE8;
+    default:
+        return MODE_EXTENDED;
+    }
 }
 
-/* read a word from the address pointed to by the pc */
+/* number of bytes following an indexed post byte */
 
-unsigned Vec3XEmulator6809::pc_read16 (void)
+static unsigned indexed_length (unsigned post)
 {
-    unsigned data;
+    if ((post & 0x80) == 0) {
+        return 0;
+    }
 
-    data = read16 (reg_pc);
-    reg_pc += 2;
+    switch (post & 0xf) {
+    case 0x8:
+    case 0xc:
+        return 1;
+    case 0x9:
+    case 0xd:
+        return 2;
+    case 0xf:
+        return post == 0x9f ? 2 : 0;
+    }
 
-    return data;
+    return 0;
+}
+
+/* decode the instruction at the given address. every byte of the
+ * instruction is read exactly once and in order, so this is safe for
+ * code running from ram as well.
+ */
+
+void Vec3XEmulator6809::decode_inst (decoded_t *inst, unsigned address)
+{
+    unsigned page, op, mode, length, operand;
+
+    length = 0;
+    page = 0;
+    op = read8 (address);
+    inst->bytes[length++] = op;
+
+    mode = opcode_mode (page, op);
+
+    if (mode == MODE_PREFIX) {
+        page = op - 0x0f;
+        op = read8 (address + length);
+        inst->bytes[length++] = op;
+        mode = opcode_mode (page, op);
+    }
+
+    inst->handler = mode == MODE_ILLEGAL ? HANDLER_ILLEGAL + page : page * HANDLER_PAGE_SIZE + op;
+    inst->post = 0;
+    operand = 0;
+
+    switch (mode) {
+    case MODE_IMMEDIATE8:
+    case MODE_DIRECT:
+        operand = read8 (address + length);
+        inst->bytes[length++] = operand;
+        break;
+    case MODE_RELATIVE8:
+        operand = read8 (address + length);
+        inst->bytes[length++] = operand;
+        operand = sign_extend (operand);
+        break;
+    case MODE_IMMEDIATE16:
+    case MODE_EXTENDED:
+    case MODE_RELATIVE16:
+        operand = read8 (address + length);
+        inst->bytes[length++] = operand;
+        op = read8 (address + length);
+        inst->bytes[length++] = op;
+        operand = (operand << 8) | op;
+        break;
+    case MODE_INDEXED:
+        op = read8 (address + length);
+        inst->bytes[length++] = op;
+        inst->post = op;
+
+        /* the offset after the post byte, a byte offset sign extended */
+
+        switch (indexed_length (op)) {
+        case 1:
+            operand = read8 (address + length);
+            inst->bytes[length++] = operand;
+            operand = sign_extend (operand);
+            break;
+        case 2:
+            operand = read8 (address + length);
+            inst->bytes[length++] = operand;
+            op = read8 (address + length);
+            inst->bytes[length++] = op;
+            operand = (operand << 8) | op;
+            break;
+        }
+
+        break;
+    }
+
+    inst->length = length;
+    inst->mode = mode;
+    inst->cycles = page == 0 ? page0_cycles[inst->bytes[0]] :
+                   (page == 1 ? page1_cycles[inst->bytes[1]] : page2_cycles[inst->bytes[1]]);
+    inst->operand = operand;
+    inst->next = 0;
+}
+
+/* look up the decoded instruction at the given address. the cartridge and
+ * the rom are read-only, so instructions in there are decoded only once
+ * and then served from the cache. everything else (ram, io) is decoded
+ * again each time it is executed, as is code in a page the cache could
+ * not be allocated for.
+ */
+
+const decoded_t* Vec3XEmulator6809::decode (unsigned address)
+{
+    decoded_t *inst, *page;
+    unsigned slot;
+
+    address &= 0xffff;
+
+    if (address < 0x8000) {
+        slot = address;
+    } else if (address >= 0xe000) {
+        slot = DECODE_CART_SIZE + (address & 0x1fff);
+    } else {
+        decode_inst (&decode_ram, address);
+        return &decode_ram;
+    }
+
+    page = decode_pages[slot / DECODE_PAGE_SIZE];
+
+    if (page == NULL) {
+        page = (decoded_t *) calloc (DECODE_PAGE_SIZE, sizeof (decoded_t));
+
+        if (page == NULL) {
+            decode_inst (&decode_ram, address);
+            return &decode_ram;
+        }
+
+        decode_pages[slot / DECODE_PAGE_SIZE] = page;
+    }
+
+    inst = &page[slot % DECODE_PAGE_SIZE];
+
+    if (inst->length == 0) {
+        decode_cached (inst, address);
+    }
+
+    return inst;
+}
+
+/* decode an instruction into its cache entry. the instruction after it is
+ * found right behind it in the same cache page, unless it starts in the
+ * next page.
+ */
+
+void Vec3XEmulator6809::decode_cached (decoded_t *inst, unsigned address)
+{
+    decode_inst (inst, address);
+
+    if (address % DECODE_PAGE_SIZE + inst->length < DECODE_PAGE_SIZE) {
+        inst->next = inst->length;
+    }
+}
+
+/* the instruction at address, which directly follows the cached inst */
+
+const decoded_t* Vec3XEmulator6809::decode_next (const decoded_t *inst, unsigned address)
+{
+    decoded_t *next;
+
+    next = (decoded_t *) inst + inst->next;
+
+    if (next->length == 0) {
+        decode_cached (next, address);
+    }
+
+    return next;
 }
 
 /* sign extend an 8-bit quantity into a 16-bit quantity */
@@ -258,7 +768,7 @@ unsigned Vec3XEmulator6809::sign_extend (unsigned data)
 
 unsigned Vec3XEmulator6809::ea_direct (void)
 {
-    return (reg_dp << 8) | pc_read8 ();
+    return (reg_dp << 8) | current->operand;
 }
 
 /* extended addressing, address is obtained from 2 bytes following
@@ -267,7 +777,7 @@ unsigned Vec3XEmulator6809::ea_direct (void)
 
 unsigned Vec3XEmulator6809::ea_extended (void)
 {
-    return pc_read16 ();
+    return current->operand;
 }
 
 /* indexed addressing */
@@ -276,9 +786,9 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
 {
     unsigned r, op, ea;
 
-    /* post byte */
+    /* post byte, the offset after it has been read by the decoder */
 
-    op = pc_read8 ();
+    op = current->post;
 
     r = (op >> 5) & 3;
 
@@ -411,28 +921,28 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
     case 0xc8: case 0xe8:
         /* byte,R */
 
-        ea = *rptr_xyus[r] + sign_extend (pc_read8 ());
+        ea = *rptr_xyus[r] + current->operand;
         *cycles += 1;
         break;
     case 0x98: case 0xb8:
     case 0xd8: case 0xf8:
         /* [byte,R] */
 
-        ea = read16 (*rptr_xyus[r] + sign_extend (pc_read8 ()));
+        ea = read16 (*rptr_xyus[r] + current->operand);
         *cycles += 4;
         break;
     case 0x89: case 0xa9:
     case 0xc9: case 0xe9:
         /* word,R */
 
-        ea = *rptr_xyus[r] + pc_read16 ();
+        ea = *rptr_xyus[r] + current->operand;
         *cycles += 4;
         break;
     case 0x99: case 0xb9:
     case 0xd9: case 0xf9:
         /* [word,R] */
 
-        ea = read16 (*rptr_xyus[r] + pc_read16 ());
+        ea = read16 (*rptr_xyus[r] + current->operand);
         *cycles += 7;
         break;
     case 0x8b: case 0xab:
@@ -453,7 +963,7 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
     case 0xcc: case 0xec:
         /* byte, PC */
 
-        r = sign_extend (pc_read8 ());
+        r = current->operand;
         ea = reg_pc + r;
         *cycles += 1;
         break;
@@ -461,7 +971,7 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
     case 0xdc: case 0xfc:
         /* [byte, PC] */
 
-        r = sign_extend (pc_read8 ());
+        r = current->operand;
         ea = read16 (reg_pc + r);
         *cycles += 4;
         break;
@@ -469,7 +979,7 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
     case 0xcd: case 0xed:
         /* word, PC */
 
-        r = pc_read16 ();
+        r = current->operand;
         ea = reg_pc + r;
         *cycles += 5;
         break;
@@ -477,14 +987,14 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
     case 0xdd: case 0xfd:
         /* [word, PC] */
 
-        r = pc_read16 ();
+        r = current->operand;
         ea = read16 (reg_pc + r);
         *cycles += 8;
         break;
     case 0x9f:
         /* [address] */
 
-        ea = read16 (pc_read16 ());
+        ea = read16 (current->operand);
         *cycles += 5;
         break;
     default:
@@ -496,6 +1006,99 @@ unsigned Vec3XEmulator6809::ea_indexed (unsigned *cycles)
     return ea;
 }
 
+/* instructions are written once per operation and instantiated for each
+ * addressing mode, the mode is a template argument so every instance
+ * reduces to the plain sequence of fetches the hand written handlers had.
+ * cycles only collects the extra cycles of indexed addressing, the base
+ * count comes from the cycle tables.
+ */
+
+template <unsigned mode>
+unsigned Vec3XEmulator6809::ea_mode (unsigned *cycles)
+{
+    if (mode == MODE_DIRECT) {
+        return ea_direct ();
+    } else if (mode == MODE_EXTENDED) {
+        return ea_extended ();
+    }
+
+    return ea_indexed (cycles);
+}
+
+template <unsigned mode>
+unsigned Vec3XEmulator6809::operand8 (unsigned *cycles)
+{
+    if (mode == MODE_IMMEDIATE8) {
+        return current->operand;
+    }
+
+    return read8 (ea_mode<mode> (cycles));
+}
+
+template <unsigned mode>
+unsigned Vec3XEmulator6809::operand16 (unsigned *cycles)
+{
+    if (mode == MODE_IMMEDIATE16) {
+        return current->operand;
+    }
+
+    return read16 (ea_mode<mode> (cycles));
+}
+
+/* read-modify-write of a memory operand */
+
+template <unsigned mode, unsigned (Vec3XEmulator6809::*op) (unsigned)>
+void Vec3XEmulator6809::modify8 (unsigned *cycles)
+{
+    unsigned ea;
+
+    ea = ea_mode<mode> (cycles);
+    write8 (ea, (this->*op) (read8 (ea)));
+}
+
+template <unsigned mode>
+void Vec3XEmulator6809::clear8 (unsigned *cycles)
+{
+    unsigned ea;
+
+    ea = ea_mode<mode> (cycles);
+    inst_clr ();
+    write8 (ea, 0);
+}
+
+/* the register is passed by address and read after the effective address
+ * is computed, indexed addressing may have incremented or decremented it.
+ */
+
+template <unsigned mode>
+void Vec3XEmulator6809::store8 (unsigned *reg, unsigned *cycles)
+{
+    unsigned ea;
+
+    ea = ea_mode<mode> (cycles);
+    write8 (ea, *reg);
+    inst_tst8 (*reg);
+}
+
+template <unsigned mode>
+void Vec3XEmulator6809::store16 (unsigned *reg, unsigned *cycles)
+{
+    unsigned ea;
+
+    ea = ea_mode<mode> (cycles);
+    write16 (ea, *reg);
+    inst_tst16 (*reg);
+}
+
+template <unsigned mode>
+void Vec3XEmulator6809::compare16 (unsigned *reg, unsigned *cycles)
+{
+    unsigned data;
+
+    data = operand16<mode> (cycles);
+    inst_sub16 (*reg, data);
+}
+
 /* instruction: neg
  * essentially (0 - data).
  */
@@ -508,11 +1111,7 @@ unsigned Vec3XEmulator6809::inst_neg (unsigned data)
     i1 = ~data;
     r = i0 + i1 + 1;
 
-    set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 1));
+    cc_defer (CC_SUB8, FLAG_H | FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -597,11 +1196,7 @@ unsigned Vec3XEmulator6809::inst_asl (unsigned data)
     i1 = data;
     r = i0 + i1;
 
-    set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 0));
+    cc_defer (CC_ADD8, FLAG_H | FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -619,10 +1214,7 @@ unsigned Vec3XEmulator6809::inst_rol (unsigned data)
     c = get_cc (FLAG_C);
     r = i0 + i1 + c;
 
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 0));
+    cc_defer (CC_ADD8, FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -639,9 +1231,7 @@ unsigned Vec3XEmulator6809::inst_dec (unsigned data)
     i1 = 0xff;
     r = i0 + i1;
 
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
+    cc_defer (CC_ADD8, FLAG_N | FLAG_Z | FLAG_V, i0, i1, r);
 
     return r;
 }
@@ -658,9 +1248,7 @@ unsigned Vec3XEmulator6809::inst_inc (unsigned data)
     i1 = 1;
     r = i0 + i1;
 
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
+    cc_defer (CC_ADD8, FLAG_N | FLAG_Z | FLAG_V, i0, i1, r);
 
     return r;
 }
@@ -669,16 +1257,12 @@ unsigned Vec3XEmulator6809::inst_inc (unsigned data)
 
 void Vec3XEmulator6809::inst_tst8 (unsigned data)
 {
-    set_cc (FLAG_N, test_n (data));
-    set_cc (FLAG_Z, test_z8 (data));
-    set_cc (FLAG_V, 0);
+    cc_defer (CC_TST8, FLAG_N | FLAG_Z | FLAG_V, 0, 0, data);
 }
 
 void Vec3XEmulator6809::inst_tst16 (unsigned data)
 {
-    set_cc (FLAG_N, test_n (data >> 8));
-    set_cc (FLAG_Z, test_z16 (data));
-    set_cc (FLAG_V, 0);
+    cc_defer (CC_TST16, FLAG_N | FLAG_Z | FLAG_V, 0, 0, data);
 }
 
 /* instruction: clr */
@@ -701,11 +1285,7 @@ unsigned Vec3XEmulator6809::inst_sub8 (unsigned data0, unsigned data1)
     i1 = ~data1;
     r = i0 + i1 + 1;
 
-    set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 1));
+    cc_defer (CC_SUB8, FLAG_H | FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -723,11 +1303,7 @@ unsigned Vec3XEmulator6809::inst_sbc (unsigned data0, unsigned data1)
     c = 1 - get_cc (FLAG_C);
     r = i0 + i1 + c;
 
-    set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 1));
+    cc_defer (CC_SUB8, FLAG_H | FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -775,11 +1351,7 @@ unsigned Vec3XEmulator6809::inst_adc (unsigned data0, unsigned data1)
     c = get_cc (FLAG_C);
     r = i0 + i1 + c;
 
-    set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 0));
+    cc_defer (CC_ADD8, FLAG_H | FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -809,11 +1381,7 @@ unsigned Vec3XEmulator6809::inst_add8 (unsigned data0, unsigned data1)
     i1 = data1;
     r = i0 + i1;
 
-    set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-    set_cc (FLAG_N, test_n (r));
-    set_cc (FLAG_Z, test_z8 (r));
-    set_cc (FLAG_V, test_v (i0, i1, r));
-    set_cc (FLAG_C, test_c (i0, i1, r, 0));
+    cc_defer (CC_ADD8, FLAG_H | FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -828,10 +1396,7 @@ unsigned Vec3XEmulator6809::inst_add16 (unsigned data0, unsigned data1)
     i1 = data1;
     r = i0 + i1;
 
-    set_cc (FLAG_N, test_n (r >> 8));
-    set_cc (FLAG_Z, test_z16 (r));
-    set_cc (FLAG_V, test_v (i0 >> 8, i1 >> 8, r >> 8));
-    set_cc (FLAG_C, test_c (i0 >> 8, i1 >> 8, r >> 8, 0));
+    cc_defer (CC_ADD16, FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
@@ -846,28 +1411,23 @@ unsigned Vec3XEmulator6809::inst_sub16 (unsigned data0, unsigned data1)
     i1 = ~data1;
     r = i0 + i1 + 1;
 
-    set_cc (FLAG_N, test_n (r >> 8));
-    set_cc (FLAG_Z, test_z16 (r));
-    set_cc (FLAG_V, test_v (i0 >> 8, i1 >> 8, r >> 8));
-    set_cc (FLAG_C, test_c (i0 >> 8, i1 >> 8, r >> 8, 1));
+    cc_defer (CC_SUB16, FLAG_N | FLAG_Z | FLAG_V | FLAG_C, i0, i1, r);
 
     return r;
 }
 
 /* instruction: 8-bit offset branch */
 
-void Vec3XEmulator6809::inst_bra8 (unsigned test, unsigned op, unsigned *cycles)
+void Vec3XEmulator6809::inst_bra8 (unsigned test, unsigned op)
 {
     unsigned offset, mask;
 
-    offset = pc_read8 ();
+    offset = current->operand; /* sign extended by the decoder */
 
     /* trying to avoid an if statement */
 
     mask = (test ^ (op & 1)) - 1; /* 0xffff when taken, 0 when not taken */
-    reg_pc += sign_extend (offset) & mask;
-
-    *cycles += 3;
+    reg_pc += offset & mask;
 }
 
 /* instruction: 16-bit offset branch */
@@ -876,14 +1436,14 @@ void Vec3XEmulator6809::inst_bra16 (unsigned test, unsigned op, unsigned *cycles
 {
     unsigned offset, mask;
 
-    offset = pc_read16 ();
+    offset = current->operand;
 
     /* trying to avoid an if statement */
 
     mask = (test ^ (op & 1)) - 1; /* 0xffff when taken, 0 when not taken */
     reg_pc += offset & mask;
 
-    *cycles += 5 - mask;
+    *cycles += mask & 1; /* one more cycle when taken */
 }
 
 /* instruction: pshs/pshu */
@@ -928,7 +1488,7 @@ void Vec3XEmulator6809::inst_psh (unsigned op, unsigned *sp,
     }
 
     if (op & 0x01) {
-        push8 (sp, reg_cc);
+        push8 (sp, get_reg_cc ());
         *cycles += 1;
     }
 }
@@ -939,7 +1499,7 @@ void Vec3XEmulator6809::inst_pul (unsigned op, unsigned *sp, unsigned *osp,
                        unsigned *cycles)
 {
     if (op & 0x01) {
-        reg_cc = pull8 (sp);
+        set_reg_cc (pull8 (sp));
         *cycles += 1;
     }
 
@@ -1010,7 +1570,7 @@ unsigned Vec3XEmulator6809::exgtfr_read (unsigned reg)
         data = 0xff00 | reg_b;
         break;
     case 0xa:
-        data = 0xff00 | reg_cc;
+        data = 0xff00 | get_reg_cc ();
         break;
     case 0xb:
         data = 0xff00 | reg_dp;
@@ -1052,7 +1612,7 @@ void Vec3XEmulator6809::exgtfr_write (unsigned reg, unsigned data)
         reg_b = data;
         break;
     case 0xa:
-        reg_cc = data;
+        set_reg_cc (data);
         break;
     case 0xb:
         reg_dp = data;
@@ -1069,7 +1629,7 @@ void Vec3XEmulator6809::inst_exg (void)
 {
     unsigned op, tmp;
 
-    op = pc_read8 ();
+    op = current->operand;
 
     tmp = exgtfr_read (op & 0xf);
     exgtfr_write (op & 0xf, exgtfr_read (op >> 4));
@@ -1082,7 +1642,7 @@ void Vec3XEmulator6809::inst_tfr (void)
 {
     unsigned op;
 
-    op = pc_read8 ();
+    op = current->operand;
 
     exgtfr_write (op & 0xf, exgtfr_read (op >> 4));
 }
@@ -1091,6 +1651,8 @@ void Vec3XEmulator6809::inst_tfr (void)
 
 void Vec3XEmulator6809::Reset()
 {
+    unsigned page;
+
     /* reset the 6809 */
     reg_x = 0;
     reg_y = 0;
@@ -1102,20 +1664,156 @@ void Vec3XEmulator6809::Reset()
 
     reg_dp = 0;
 
-    reg_cc = FLAG_I | FLAG_F;
+    set_reg_cc (FLAG_I | FLAG_F);
     irq_status = IRQ_NORMAL;
 
+    /* cartridge may have changed, drop every decoded instruction */
+    for (page = 0; page < DECODE_PAGES; page++) {
+        if (decode_pages[page] != NULL) {
+            memset (decode_pages[page], 0, sizeof (decoded_t) * DECODE_PAGE_SIZE);
+        }
+    }
+
     reg_pc = read16 (0xfffe);
 }
 
-/* execute a single instruction or handle interrupts and return */
+/* the cartridge bank has been switched, code decoded from the old bank
+ * must not be used anymore.
+ */
 
-unsigned Vec3XEmulator6809::Step(unsigned irq_i, unsigned irq_f)
+void Vec3XEmulator6809::FlushCartridge()
 {
-    unsigned op;
-    unsigned cycles = 0;
+    unsigned page;
+
+    for (page = 0; page < DECODE_CART_SIZE / DECODE_PAGE_SIZE; page++) {
+        if (decode_pages[page] != NULL) {
+            memset (decode_pages[page], 0, sizeof (decoded_t) * DECODE_PAGE_SIZE);
+        }
+    }
+}
+
+/* handle interrupts, then execute instructions until the run ends, see
+ * STEP_CHECK. counts on from the run_cycles already spent in this run and
+ * returns the new total, at least one instruction is executed unless the
+ * cpu is waiting in sync or cwai.
+ */
+
+unsigned Vec3XEmulator6809::Step(unsigned irq_i, unsigned irq_f, unsigned limit)
+{
+    const decoded_t *inst;
+    unsigned op, pc, irq_wait;
+    unsigned cycles = run_cycles;
     unsigned ea, i0, i1, r;
 
+#ifdef VEC3X_THREADED_DISPATCH
+    static const void *const step_table[HANDLER_COUNT] = {
+        /* page 0 */
+        &&page0_00, &&page0_illegal, &&page0_illegal, &&page0_03, &&page0_04, &&page0_illegal, &&page0_06, &&page0_07,
+        &&page0_08, &&page0_09, &&page0_0a, &&page0_illegal, &&page0_0c, &&page0_0d, &&page0_0e, &&page0_0f,
+        &&page0_illegal, &&page0_illegal, &&page0_12, &&page0_13, &&page0_illegal, &&page0_illegal, &&page0_16, &&page0_17,
+        &&page0_illegal, &&page0_19, &&page0_1a, &&page0_illegal, &&page0_1c, &&page0_1d, &&page0_1e, &&page0_1f,
+        &&page0_20, &&page0_21, &&page0_22, &&page0_23, &&page0_24, &&page0_25, &&page0_26, &&page0_27,
+        &&page0_28, &&page0_29, &&page0_2a, &&page0_2b, &&page0_2c, &&page0_2d, &&page0_2e, &&page0_2f,
+        &&page0_30, &&page0_31, &&page0_32, &&page0_33, &&page0_34, &&page0_35, &&page0_36, &&page0_37,
+        &&page0_illegal, &&page0_39, &&page0_3a, &&page0_3b, &&page0_3c, &&page0_3d, &&page0_illegal, &&page0_3f,
+        &&page0_40, &&page0_illegal, &&page0_illegal, &&page0_43, &&page0_44, &&page0_illegal, &&page0_46, &&page0_47,
+        &&page0_48, &&page0_49, &&page0_4a, &&page0_illegal, &&page0_4c, &&page0_4d, &&page0_illegal, &&page0_4f,
+        &&page0_50, &&page0_illegal, &&page0_illegal, &&page0_53, &&page0_54, &&page0_illegal, &&page0_56, &&page0_57,
+        &&page0_58, &&page0_59, &&page0_5a, &&page0_illegal, &&page0_5c, &&page0_5d, &&page0_illegal, &&page0_5f,
+        &&page0_60, &&page0_illegal, &&page0_illegal, &&page0_63, &&page0_64, &&page0_illegal, &&page0_66, &&page0_67,
+        &&page0_68, &&page0_69, &&page0_6a, &&page0_illegal, &&page0_6c, &&page0_6d, &&page0_6e, &&page0_6f,
+        &&page0_70, &&page0_illegal, &&page0_illegal, &&page0_73, &&page0_74, &&page0_illegal, &&page0_76, &&page0_77,
+        &&page0_78, &&page0_79, &&page0_7a, &&page0_illegal, &&page0_7c, &&page0_7d, &&page0_7e, &&page0_7f,
+        &&page0_80, &&page0_81, &&page0_82, &&page0_83, &&page0_84, &&page0_85, &&page0_86, &&page0_illegal,
+        &&page0_88, &&page0_89, &&page0_8a, &&page0_8b, &&page0_8c, &&page0_8d, &&page0_8e, &&page0_illegal,
+        &&page0_90, &&page0_91, &&page0_92, &&page0_93, &&page0_94, &&page0_95, &&page0_96, &&page0_97,
+        &&page0_98, &&page0_99, &&page0_9a, &&page0_9b, &&page0_9c, &&page0_9d, &&page0_9e, &&page0_9f,
+        &&page0_a0, &&page0_a1, &&page0_a2, &&page0_a3, &&page0_a4, &&page0_a5, &&page0_a6, &&page0_a7,
+        &&page0_a8, &&page0_a9, &&page0_aa, &&page0_ab, &&page0_ac, &&page0_ad, &&page0_ae, &&page0_af,
+        &&page0_b0, &&page0_b1, &&page0_b2, &&page0_b3, &&page0_b4, &&page0_b5, &&page0_b6, &&page0_b7,
+        &&page0_b8, &&page0_b9, &&page0_ba, &&page0_bb, &&page0_bc, &&page0_bd, &&page0_be, &&page0_bf,
+        &&page0_c0, &&page0_c1, &&page0_c2, &&page0_c3, &&page0_c4, &&page0_c5, &&page0_c6, &&page0_illegal,
+        &&page0_c8, &&page0_c9, &&page0_ca, &&page0_cb, &&page0_cc, &&page0_illegal, &&page0_ce, &&page0_illegal,
+        &&page0_d0, &&page0_d1, &&page0_d2, &&page0_d3, &&page0_d4, &&page0_d5, &&page0_d6, &&page0_d7,
+        &&page0_d8, &&page0_d9, &&page0_da, &&page0_db, &&page0_dc, &&page0_dd, &&page0_de, &&page0_df,
+        &&page0_e0, &&page0_e1, &&page0_e2, &&page0_e3, &&page0_e4, &&page0_e5, &&page0_e6, &&page0_e7,
+        &&page0_e8, &&page0_e9, &&page0_ea, &&page0_eb, &&page0_ec, &&page0_ed, &&page0_ee, &&page0_ef,
+        &&page0_f0, &&page0_f1, &&page0_f2, &&page0_f3, &&page0_f4, &&page0_f5, &&page0_f6, &&page0_f7,
+        &&page0_f8, &&page0_f9, &&page0_fa, &&page0_fb, &&page0_fc, &&page0_fd, &&page0_fe, &&page0_ff,
+
+        /* page 1 */
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_20, &&page1_21, &&page1_22, &&page1_23, &&page1_24, &&page1_25, &&page1_26, &&page1_27,
+        &&page1_28, &&page1_29, &&page1_2a, &&page1_2b, &&page1_2c, &&page1_2d, &&page1_2e, &&page1_2f,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_3f,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_83, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_8c, &&page1_illegal, &&page1_8e, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_93, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_9c, &&page1_illegal, &&page1_9e, &&page1_9f,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_a3, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_ac, &&page1_illegal, &&page1_ae, &&page1_af,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_b3, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_bc, &&page1_illegal, &&page1_be, &&page1_bf,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_ce, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_de, &&page1_df,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_ee, &&page1_ef,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal,
+        &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_illegal, &&page1_fe, &&page1_ff,
+
+        /* page 2 */
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_3f,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_83, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_8c, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_93, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_9c, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_a3, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_ac, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_b3, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_bc, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+        &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal, &&page2_illegal,
+
+        /* illegal op codes of each page */
+        &&page0_illegal, &&page1_illegal, &&page2_illegal
+    };
+#endif
+
     if (irq_f) {
         if (get_cc (FLAG_F) == 0) {
             if (irq_status != IRQ_CWAI) {
@@ -1129,6 +1827,10 @@ unsigned Vec3XEmulator6809::Step(unsigned irq_i, unsigned irq_f)
             reg_pc = read16 (0xfff6);
             irq_status = IRQ_NORMAL;
             cycles += 7;
+
+            /* whatever loop got interrupted is not timed any further */
+            loop_pc = 0x10000;
+            loop_branch = 0;
         } else {
             if (irq_status == IRQ_SYNC) {
                 irq_status = IRQ_NORMAL;
@@ -1148,6 +1850,8 @@ unsigned Vec3XEmulator6809::Step(unsigned irq_i, unsigned irq_f)
             reg_pc = read16 (0xfff8);
             irq_status = IRQ_NORMAL;
             cycles += 7;
+            loop_pc = 0x10000;
+            loop_branch = 0;
         } else {
             if (irq_status == IRQ_SYNC) {
                 irq_status = IRQ_NORMAL;
@@ -1156,1165 +1860,814 @@ unsigned Vec3XEmulator6809::Step(unsigned irq_i, unsigned irq_f)
     }
 
     if (irq_status != IRQ_NORMAL) {
-        return cycles + 1;
+        /* still waiting with the same irq lines, every further step would
+         * only take one more cycle.
+         */
+
+        cycles++;
+
+        return cycles < limit ? limit : cycles;
     }
 
-    op = pc_read8 ();
+    /* the flags that let a pending interrupt in */
+    irq_wait = (irq_i ? FLAG_I : 0) | (irq_f ? FLAG_F : 0);
 
-    switch (op) {
+    inst = decode (reg_pc);
+
+#ifndef VEC3X_THREADED_DISPATCH
+    goto step_enter;
+
+step_next:
+    STEP_CHECK
+    STEP_FETCH
+
+step_enter:
+#endif
+    STEP_ENTER
+
+    DISPATCH
     /* page 0 instructions */
 
     /* neg, nega, negb */
-    case 0x00:
-        ea = ea_direct ();
-        r = inst_neg (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x40:
+    OPCODE (page0, 00)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_neg> (&cycles);
+        NEXT;
+    OPCODE (page0, 40)
         reg_a = inst_neg (reg_a);
-        cycles += 2;
-        break;
-    case 0x50:
+        NEXT;
+    OPCODE (page0, 50)
         reg_b = inst_neg (reg_b);
-        cycles += 2;
-        break;
-    case 0x60:
-        ea = ea_indexed (&cycles);
-        r = inst_neg (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x70:
-        ea = ea_extended ();
-        r = inst_neg (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 60)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_neg> (&cycles);
+        NEXT;
+    OPCODE (page0, 70)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_neg> (&cycles);
+        NEXT;
     /* com, coma, comb */
-    case 0x03:
-        ea = ea_direct ();
-        r = inst_com (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x43:
+    OPCODE (page0, 03)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_com> (&cycles);
+        NEXT;
+    OPCODE (page0, 43)
         reg_a = inst_com (reg_a);
-        cycles += 2;
-        break;
-    case 0x53:
+        NEXT;
+    OPCODE (page0, 53)
         reg_b = inst_com (reg_b);
-        cycles += 2;
-        break;
-    case 0x63:
-        ea = ea_indexed (&cycles);
-        r = inst_com (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x73:
-        ea = ea_extended ();
-        r = inst_com (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 63)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_com> (&cycles);
+        NEXT;
+    OPCODE (page0, 73)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_com> (&cycles);
+        NEXT;
     /* lsr, lsra, lsrb */
-    case 0x04:
-        ea = ea_direct ();
-        r = inst_lsr (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x44:
+    OPCODE (page0, 04)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_lsr> (&cycles);
+        NEXT;
+    OPCODE (page0, 44)
         reg_a = inst_lsr (reg_a);
-        cycles += 2;
-        break;
-    case 0x54:
+        NEXT;
+    OPCODE (page0, 54)
         reg_b = inst_lsr (reg_b);
-        cycles += 2;
-        break;
-    case 0x64:
-        ea = ea_indexed (&cycles);
-        r = inst_lsr (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x74:
-        ea = ea_extended ();
-        r = inst_lsr (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 64)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_lsr> (&cycles);
+        NEXT;
+    OPCODE (page0, 74)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_lsr> (&cycles);
+        NEXT;
     /* ror, rora, rorb */
-    case 0x06:
-        ea = ea_direct ();
-        r = inst_ror (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x46:
+    OPCODE (page0, 06)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_ror> (&cycles);
+        NEXT;
+    OPCODE (page0, 46)
         reg_a = inst_ror (reg_a);
-        cycles += 2;
-        break;
-    case 0x56:
+        NEXT;
+    OPCODE (page0, 56)
         reg_b = inst_ror (reg_b);
-        cycles += 2;
-        break;
-    case 0x66:
-        ea = ea_indexed (&cycles);
-        r = inst_ror (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x76:
-        ea = ea_extended ();
-        r = inst_ror (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 66)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_ror> (&cycles);
+        NEXT;
+    OPCODE (page0, 76)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_ror> (&cycles);
+        NEXT;
     /* asr, asra, asrb */
-    case 0x07:
-        ea = ea_direct ();
-        r = inst_asr (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x47:
+    OPCODE (page0, 07)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_asr> (&cycles);
+        NEXT;
+    OPCODE (page0, 47)
         reg_a = inst_asr (reg_a);
-        cycles += 2;
-        break;
-    case 0x57:
+        NEXT;
+    OPCODE (page0, 57)
         reg_b = inst_asr (reg_b);
-        cycles += 2;
-        break;
-    case 0x67:
-        ea = ea_indexed (&cycles);
-        r = inst_asr (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x77:
-        ea = ea_extended ();
-        r = inst_asr (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 67)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_asr> (&cycles);
+        NEXT;
+    OPCODE (page0, 77)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_asr> (&cycles);
+        NEXT;
     /* asl, asla, aslb */
-    case 0x08:
-        ea = ea_direct ();
-        r = inst_asl (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x48:
+    OPCODE (page0, 08)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_asl> (&cycles);
+        NEXT;
+    OPCODE (page0, 48)
         reg_a = inst_asl (reg_a);
-        cycles += 2;
-        break;
-    case 0x58:
+        NEXT;
+    OPCODE (page0, 58)
         reg_b = inst_asl (reg_b);
-        cycles += 2;
-        break;
-    case 0x68:
-        ea = ea_indexed (&cycles);
-        r = inst_asl (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x78:
-        ea = ea_extended ();
-        r = inst_asl (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 68)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_asl> (&cycles);
+        NEXT;
+    OPCODE (page0, 78)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_asl> (&cycles);
+        NEXT;
     /* rol, rola, rolb */
-    case 0x09:
-        ea = ea_direct ();
-        r = inst_rol (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x49:
+    OPCODE (page0, 09)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_rol> (&cycles);
+        NEXT;
+    OPCODE (page0, 49)
         reg_a = inst_rol (reg_a);
-        cycles += 2;
-        break;
-    case 0x59:
+        NEXT;
+    OPCODE (page0, 59)
         reg_b = inst_rol (reg_b);
-        cycles += 2;
-        break;
-    case 0x69:
-        ea = ea_indexed (&cycles);
-        r = inst_rol (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x79:
-        ea = ea_extended ();
-        r = inst_rol (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 69)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_rol> (&cycles);
+        NEXT;
+    OPCODE (page0, 79)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_rol> (&cycles);
+        NEXT;
     /* dec, deca, decb */
-    case 0x0a:
-        ea = ea_direct ();
-        r = inst_dec (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x4a:
+    OPCODE (page0, 0a)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_dec> (&cycles);
+        NEXT;
+    OPCODE (page0, 4a)
         reg_a = inst_dec (reg_a);
-        cycles += 2;
-        break;
-    case 0x5a:
+        NEXT;
+    OPCODE (page0, 5a)
         reg_b = inst_dec (reg_b);
-        cycles += 2;
-        break;
-    case 0x6a:
-        ea = ea_indexed (&cycles);
-        r = inst_dec (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x7a:
-        ea = ea_extended ();
-        r = inst_dec (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 6a)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_dec> (&cycles);
+        NEXT;
+    OPCODE (page0, 7a)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_dec> (&cycles);
+        NEXT;
     /* inc, inca, incb */
-    case 0x0c:
-        ea = ea_direct ();
-        r = inst_inc (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x4c:
+    OPCODE (page0, 0c)
+        modify8<MODE_DIRECT, &Vec3XEmulator6809::inst_inc> (&cycles);
+        NEXT;
+    OPCODE (page0, 4c)
         reg_a = inst_inc (reg_a);
-        cycles += 2;
-        break;
-    case 0x5c:
+        NEXT;
+    OPCODE (page0, 5c)
         reg_b = inst_inc (reg_b);
-        cycles += 2;
-        break;
-    case 0x6c:
-        ea = ea_indexed (&cycles);
-        r = inst_inc (read8 (ea));
-        write8 (ea, r);
-        cycles += 6;
-        break;
-    case 0x7c:
-        ea = ea_extended ();
-        r = inst_inc (read8 (ea));
-        write8 (ea, r);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 6c)
+        modify8<MODE_INDEXED, &Vec3XEmulator6809::inst_inc> (&cycles);
+        NEXT;
+    OPCODE (page0, 7c)
+        modify8<MODE_EXTENDED, &Vec3XEmulator6809::inst_inc> (&cycles);
+        NEXT;
     /* tst, tsta, tstb */
-    case 0x0d:
-        ea = ea_direct ();
-        inst_tst8 (read8 (ea));
-        cycles += 6;
-        break;
-    case 0x4d:
+    OPCODE (page0, 0d)
+        inst_tst8 (operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, 4d)
         inst_tst8 (reg_a);
-        cycles += 2;
-        break;
-    case 0x5d:
+        NEXT;
+    OPCODE (page0, 5d)
         inst_tst8 (reg_b);
-        cycles += 2;
-        break;
-    case 0x6d:
-        ea = ea_indexed (&cycles);
-        inst_tst8 (read8 (ea));
-        cycles += 6;
-        break;
-    case 0x7d:
-        ea = ea_extended ();
-        inst_tst8 (read8 (ea));
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 6d)
+        inst_tst8 (operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, 7d)
+        inst_tst8 (operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* jmp */
-    case 0x0e:
-        reg_pc = ea_direct ();
-        cycles += 3;
-        break;
-    case 0x6e:
-        reg_pc = ea_indexed (&cycles);
-        cycles += 3;
-        break;
-    case 0x7e:
-        reg_pc = ea_extended ();
-        cycles += 4;
-        break;
+    OPCODE (page0, 0e)
+        reg_pc = ea_mode<MODE_DIRECT> (&cycles);
+        NEXT;
+    OPCODE (page0, 6e)
+        reg_pc = ea_mode<MODE_INDEXED> (&cycles);
+        NEXT;
+    OPCODE (page0, 7e)
+        reg_pc = ea_mode<MODE_EXTENDED> (&cycles);
+        NEXT;
     /* clr */
-    case 0x0f:
-        ea = ea_direct ();
-        inst_clr ();
-        write8 (ea, 0);
-        cycles += 6;
-        break;
-    case 0x4f:
+    OPCODE (page0, 0f)
+        clear8<MODE_DIRECT> (&cycles);
+        NEXT;
+    OPCODE (page0, 4f)
         inst_clr ();
         reg_a = 0;
-        cycles += 2;
-        break;
-    case 0x5f:
+        NEXT;
+    OPCODE (page0, 5f)
         inst_clr ();
         reg_b = 0;
-        cycles += 2;
-        break;
-    case 0x6f:
-        ea = ea_indexed (&cycles);
-        inst_clr ();
-        write8 (ea, 0);
-        cycles += 6;
-        break;
-    case 0x7f:
-        ea = ea_extended ();
-        inst_clr ();
-        write8 (ea, 0);
-        cycles += 7;
-        break;
+        NEXT;
+    OPCODE (page0, 6f)
+        clear8<MODE_INDEXED> (&cycles);
+        NEXT;
+    OPCODE (page0, 7f)
+        clear8<MODE_EXTENDED> (&cycles);
+        NEXT;
     /* suba */
-    case 0x80:
-        reg_a = inst_sub8 (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x90:
-        ea = ea_direct ();
-        reg_a = inst_sub8 (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa0:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_sub8 (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb0:
-        ea = ea_extended ();
-        reg_a = inst_sub8 (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 80)
+        reg_a = inst_sub8 (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 90)
+        reg_a = inst_sub8 (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a0)
+        reg_a = inst_sub8 (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b0)
+        reg_a = inst_sub8 (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* subb */
-    case 0xc0:
-        reg_b = inst_sub8 (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd0:
-        ea = ea_direct ();
-        reg_b = inst_sub8 (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe0:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_sub8 (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf0:
-        ea = ea_extended ();
-        reg_b = inst_sub8 (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c0)
+        reg_b = inst_sub8 (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d0)
+        reg_b = inst_sub8 (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e0)
+        reg_b = inst_sub8 (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f0)
+        reg_b = inst_sub8 (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* cmpa */
-    case 0x81:
-        inst_sub8 (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x91:
-        ea = ea_direct ();
-        inst_sub8 (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa1:
-        ea = ea_indexed (&cycles);
-        inst_sub8 (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb1:
-        ea = ea_extended ();
-        inst_sub8 (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 81)
+        inst_sub8 (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 91)
+        inst_sub8 (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a1)
+        inst_sub8 (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b1)
+        inst_sub8 (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* cmpb */
-    case 0xc1:
-        inst_sub8 (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd1:
-        ea = ea_direct ();
-        inst_sub8 (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe1:
-        ea = ea_indexed (&cycles);
-        inst_sub8 (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf1:
-        ea = ea_extended ();
-        inst_sub8 (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c1)
+        inst_sub8 (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d1)
+        inst_sub8 (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e1)
+        inst_sub8 (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f1)
+        inst_sub8 (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* sbca */
-    case 0x82:
-        reg_a = inst_sbc (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x92:
-        ea = ea_direct ();
-        reg_a = inst_sbc (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa2:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_sbc (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb2:
-        ea = ea_extended ();
-        reg_a = inst_sbc (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 82)
+        reg_a = inst_sbc (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 92)
+        reg_a = inst_sbc (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a2)
+        reg_a = inst_sbc (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b2)
+        reg_a = inst_sbc (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* sbcb */
-    case 0xc2:
-        reg_b = inst_sbc (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd2:
-        ea = ea_direct ();
-        reg_b = inst_sbc (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe2:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_sbc (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf2:
-        ea = ea_extended ();
-        reg_b = inst_sbc (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c2)
+        reg_b = inst_sbc (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d2)
+        reg_b = inst_sbc (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e2)
+        reg_b = inst_sbc (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f2)
+        reg_b = inst_sbc (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* anda */
-    case 0x84:
-        reg_a = inst_and (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x94:
-        ea = ea_direct ();
-        reg_a = inst_and (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa4:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_and (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb4:
-        ea = ea_extended ();
-        reg_a = inst_and (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 84)
+        reg_a = inst_and (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 94)
+        reg_a = inst_and (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a4)
+        reg_a = inst_and (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b4)
+        reg_a = inst_and (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* andb */
-    case 0xc4:
-        reg_b = inst_and (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd4:
-        ea = ea_direct ();
-        reg_b = inst_and (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe4:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_and (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf4:
-        ea = ea_extended ();
-        reg_b = inst_and (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c4)
+        reg_b = inst_and (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d4)
+        reg_b = inst_and (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e4)
+        reg_b = inst_and (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f4)
+        reg_b = inst_and (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* bita */
-    case 0x85:
-        inst_and (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x95:
-        ea = ea_direct ();
-        inst_and (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa5:
-        ea = ea_indexed (&cycles);
-        inst_and (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb5:
-        ea = ea_extended ();
-        inst_and (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 85)
+        inst_and (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 95)
+        inst_and (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a5)
+        inst_and (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b5)
+        inst_and (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* bitb */
-    case 0xc5:
-        inst_and (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd5:
-        ea = ea_direct ();
-        inst_and (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe5:
-        ea = ea_indexed (&cycles);
-        inst_and (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf5:
-        ea = ea_extended ();
-        inst_and (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c5)
+        inst_and (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d5)
+        inst_and (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e5)
+        inst_and (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f5)
+        inst_and (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* lda */
-    case 0x86:
-        reg_a = pc_read8 ();
+    OPCODE (page0, 86)
+        reg_a = operand8<MODE_IMMEDIATE8> (&cycles);
         inst_tst8 (reg_a);
-        cycles += 2;
-        break;
-    case 0x96:
-        ea = ea_direct ();
-        reg_a = read8 (ea);
+        NEXT;
+    OPCODE (page0, 96)
+        reg_a = operand8<MODE_DIRECT> (&cycles);
         inst_tst8 (reg_a);
-        cycles += 4;
-        break;
-    case 0xa6:
-        ea = ea_indexed (&cycles);
-        reg_a = read8 (ea);
+        NEXT;
+    OPCODE (page0, a6)
+        reg_a = operand8<MODE_INDEXED> (&cycles);
         inst_tst8 (reg_a);
-        cycles += 4;
-        break;
-    case 0xb6:
-        ea = ea_extended ();
-        reg_a = read8 (ea);
+        NEXT;
+    OPCODE (page0, b6)
+        reg_a = operand8<MODE_EXTENDED> (&cycles);
         inst_tst8 (reg_a);
-        cycles += 5;
-        break;
+        NEXT;
     /* ldb */
-    case 0xc6:
-        reg_b = pc_read8 ();
+    OPCODE (page0, c6)
+        reg_b = operand8<MODE_IMMEDIATE8> (&cycles);
         inst_tst8 (reg_b);
-        cycles += 2;
-        break;
-    case 0xd6:
-        ea = ea_direct ();
-        reg_b = read8 (ea);
+        NEXT;
+    OPCODE (page0, d6)
+        reg_b = operand8<MODE_DIRECT> (&cycles);
         inst_tst8 (reg_b);
-        cycles += 4;
-        break;
-    case 0xe6:
-        ea = ea_indexed (&cycles);
-        reg_b = read8 (ea);
+        NEXT;
+    OPCODE (page0, e6)
+        reg_b = operand8<MODE_INDEXED> (&cycles);
         inst_tst8 (reg_b);
-        cycles += 4;
-        break;
-    case 0xf6:
-        ea = ea_extended ();
-        reg_b = read8 (ea);
+        NEXT;
+    OPCODE (page0, f6)
+        reg_b = operand8<MODE_EXTENDED> (&cycles);
         inst_tst8 (reg_b);
-        cycles += 5;
-        break;
+        NEXT;
     /* sta */
-    case 0x97:
-        ea = ea_direct ();
-        write8 (ea, reg_a);
-        inst_tst8 (reg_a);
-        cycles += 4;
-        break;
-    case 0xa7:
-        ea = ea_indexed (&cycles);
-        write8 (ea, reg_a);
-        inst_tst8 (reg_a);
-        cycles += 4;
-        break;
-    case 0xb7:
-        ea = ea_extended ();
-        write8 (ea, reg_a);
-        inst_tst8 (reg_a);
-        cycles += 5;
-        break;
+    OPCODE (page0, 97)
+        store8<MODE_DIRECT> (&reg_a, &cycles);
+        NEXT;
+    OPCODE (page0, a7)
+        store8<MODE_INDEXED> (&reg_a, &cycles);
+        NEXT;
+    OPCODE (page0, b7)
+        store8<MODE_EXTENDED> (&reg_a, &cycles);
+        NEXT;
     /* stb */
-    case 0xd7:
-        ea = ea_direct ();
-        write8 (ea, reg_b);
-        inst_tst8 (reg_b);
-        cycles += 4;
-        break;
-    case 0xe7:
-        ea = ea_indexed (&cycles);
-        write8 (ea, reg_b);
-        inst_tst8 (reg_b);
-        cycles += 4;
-        break;
-    case 0xf7:
-        ea = ea_extended ();
-        write8 (ea, reg_b);
-        inst_tst8 (reg_b);
-        cycles += 5;
-        break;
+    OPCODE (page0, d7)
+        store8<MODE_DIRECT> (&reg_b, &cycles);
+        NEXT;
+    OPCODE (page0, e7)
+        store8<MODE_INDEXED> (&reg_b, &cycles);
+        NEXT;
+    OPCODE (page0, f7)
+        store8<MODE_EXTENDED> (&reg_b, &cycles);
+        NEXT;
     /* eora */
-    case 0x88:
-        reg_a = inst_eor (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x98:
-        ea = ea_direct ();
-        reg_a = inst_eor (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa8:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_eor (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb8:
-        ea = ea_extended ();
-        reg_a = inst_eor (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 88)
+        reg_a = inst_eor (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 98)
+        reg_a = inst_eor (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a8)
+        reg_a = inst_eor (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b8)
+        reg_a = inst_eor (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* eorb */
-    case 0xc8:
-        reg_b = inst_eor (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd8:
-        ea = ea_direct ();
-        reg_b = inst_eor (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe8:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_eor (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf8:
-        ea = ea_extended ();
-        reg_b = inst_eor (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c8)
+        reg_b = inst_eor (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d8)
+        reg_b = inst_eor (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e8)
+        reg_b = inst_eor (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f8)
+        reg_b = inst_eor (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* adca */
-    case 0x89:
-        reg_a = inst_adc (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x99:
-        ea = ea_direct ();
-        reg_a = inst_adc (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xa9:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_adc (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xb9:
-        ea = ea_extended ();
-        reg_a = inst_adc (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 89)
+        reg_a = inst_adc (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 99)
+        reg_a = inst_adc (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, a9)
+        reg_a = inst_adc (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, b9)
+        reg_a = inst_adc (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* adcb */
-    case 0xc9:
-        reg_b = inst_adc (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xd9:
-        ea = ea_direct ();
-        reg_b = inst_adc (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xe9:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_adc (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xf9:
-        ea = ea_extended ();
-        reg_b = inst_adc (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, c9)
+        reg_b = inst_adc (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, d9)
+        reg_b = inst_adc (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, e9)
+        reg_b = inst_adc (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, f9)
+        reg_b = inst_adc (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* ora */
-    case 0x8a:
-        reg_a = inst_or (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x9a:
-        ea = ea_direct ();
-        reg_a = inst_or (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xaa:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_or (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xba:
-        ea = ea_extended ();
-        reg_a = inst_or (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 8a)
+        reg_a = inst_or (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 9a)
+        reg_a = inst_or (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, aa)
+        reg_a = inst_or (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, ba)
+        reg_a = inst_or (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* orb */
-    case 0xca:
-        reg_b = inst_or (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xda:
-        ea = ea_direct ();
-        reg_b = inst_or (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xea:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_or (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xfa:
-        ea = ea_extended ();
-        reg_b = inst_or (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, ca)
+        reg_b = inst_or (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, da)
+        reg_b = inst_or (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, ea)
+        reg_b = inst_or (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, fa)
+        reg_b = inst_or (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* adda */
-    case 0x8b:
-        reg_a = inst_add8 (reg_a, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0x9b:
-        ea = ea_direct ();
-        reg_a = inst_add8 (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xab:
-        ea = ea_indexed (&cycles);
-        reg_a = inst_add8 (reg_a, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xbb:
-        ea = ea_extended ();
-        reg_a = inst_add8 (reg_a, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, 8b)
+        reg_a = inst_add8 (reg_a, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, 9b)
+        reg_a = inst_add8 (reg_a, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, ab)
+        reg_a = inst_add8 (reg_a, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, bb)
+        reg_a = inst_add8 (reg_a, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* addb */
-    case 0xcb:
-        reg_b = inst_add8 (reg_b, pc_read8 ());
-        cycles += 2;
-        break;
-    case 0xdb:
-        ea = ea_direct ();
-        reg_b = inst_add8 (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xeb:
-        ea = ea_indexed (&cycles);
-        reg_b = inst_add8 (reg_b, read8 (ea));
-        cycles += 4;
-        break;
-    case 0xfb:
-        ea = ea_extended ();
-        reg_b = inst_add8 (reg_b, read8 (ea));
-        cycles += 5;
-        break;
+    OPCODE (page0, cb)
+        reg_b = inst_add8 (reg_b, operand8<MODE_IMMEDIATE8> (&cycles));
+        NEXT;
+    OPCODE (page0, db)
+        reg_b = inst_add8 (reg_b, operand8<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page0, eb)
+        reg_b = inst_add8 (reg_b, operand8<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page0, fb)
+        reg_b = inst_add8 (reg_b, operand8<MODE_EXTENDED> (&cycles));
+        NEXT;
     /* subd */
-    case 0x83:
-        set_reg_d (inst_sub16 (get_reg_d (), pc_read16 ()));
-        cycles += 4;
-        break;
-    case 0x93:
-        ea = ea_direct ();
-        set_reg_d (inst_sub16 (get_reg_d (), read16 (ea)));
-        cycles += 6;
-        break;
-    case 0xa3:
-        ea = ea_indexed (&cycles);
-        set_reg_d (inst_sub16 (get_reg_d (), read16 (ea)));
-        cycles += 6;
-        break;
-    case 0xb3:
-        ea = ea_extended ();
-        set_reg_d (inst_sub16 (get_reg_d (), read16 (ea)));
-        cycles += 7;
-        break;
+    OPCODE (page0, 83)
+        set_reg_d (inst_sub16 (get_reg_d (), operand16<MODE_IMMEDIATE16> (&cycles)));
+        NEXT;
+    OPCODE (page0, 93)
+        set_reg_d (inst_sub16 (get_reg_d (), operand16<MODE_DIRECT> (&cycles)));
+        NEXT;
+    OPCODE (page0, a3)
+        set_reg_d (inst_sub16 (get_reg_d (), operand16<MODE_INDEXED> (&cycles)));
+        NEXT;
+    OPCODE (page0, b3)
+        set_reg_d (inst_sub16 (get_reg_d (), operand16<MODE_EXTENDED> (&cycles)));
+        NEXT;
     /* cmpx */
-    case 0x8c:
-        inst_sub16 (reg_x, pc_read16 ());
-        cycles += 4;
-        break;
-    case 0x9c:
-        ea = ea_direct ();
-        inst_sub16 (reg_x, read16 (ea));
-        cycles += 6;
-        break;
-    case 0xac:
-        ea = ea_indexed (&cycles);
-        inst_sub16 (reg_x, read16 (ea));
-        cycles += 6;
-        break;
-    case 0xbc:
-        ea = ea_extended ();
-        inst_sub16 (reg_x, read16 (ea));
-        cycles += 7;
-        break;
+    OPCODE (page0, 8c)
+        compare16<MODE_IMMEDIATE16> (&reg_x, &cycles);
+        NEXT;
+    OPCODE (page0, 9c)
+        compare16<MODE_DIRECT> (&reg_x, &cycles);
+        NEXT;
+    OPCODE (page0, ac)
+        compare16<MODE_INDEXED> (&reg_x, &cycles);
+        NEXT;
+    OPCODE (page0, bc)
+        compare16<MODE_EXTENDED> (&reg_x, &cycles);
+        NEXT;
     /* ldx */
-    case 0x8e:
-        reg_x = pc_read16 ();
+    OPCODE (page0, 8e)
+        reg_x = operand16<MODE_IMMEDIATE16> (&cycles);
         inst_tst16 (reg_x);
-        cycles += 3;
-        break;
-    case 0x9e:
-        ea = ea_direct ();
-        reg_x = read16 (ea);
+        NEXT;
+    OPCODE (page0, 9e)
+        reg_x = operand16<MODE_DIRECT> (&cycles);
         inst_tst16 (reg_x);
-        cycles += 5;
-        break;
-    case 0xae:
-        ea = ea_indexed (&cycles);
-        reg_x = read16 (ea);
+        NEXT;
+    OPCODE (page0, ae)
+        reg_x = operand16<MODE_INDEXED> (&cycles);
         inst_tst16 (reg_x);
-        cycles += 5;
-        break;
-    case 0xbe:
-        ea = ea_extended ();
-        reg_x = read16 (ea);
+        NEXT;
+    OPCODE (page0, be)
+        reg_x = operand16<MODE_EXTENDED> (&cycles);
         inst_tst16 (reg_x);
-        cycles += 6;
-        break;
+        NEXT;
     /* ldu */
-    case 0xce:
-        reg_u = pc_read16 ();
+    OPCODE (page0, ce)
+        reg_u = operand16<MODE_IMMEDIATE16> (&cycles);
         inst_tst16 (reg_u);
-        cycles += 3;
-        break;
-    case 0xde:
-        ea = ea_direct ();
-        reg_u = read16 (ea);
+        NEXT;
+    OPCODE (page0, de)
+        reg_u = operand16<MODE_DIRECT> (&cycles);
         inst_tst16 (reg_u);
-        cycles += 5;
-        break;
-    case 0xee:
-        ea = ea_indexed (&cycles);
-        reg_u = read16 (ea);
+        NEXT;
+    OPCODE (page0, ee)
+        reg_u = operand16<MODE_INDEXED> (&cycles);
         inst_tst16 (reg_u);
-        cycles += 5;
-        break;
-    case 0xfe:
-        ea = ea_extended ();
-        reg_u = read16 (ea);
+        NEXT;
+    OPCODE (page0, fe)
+        reg_u = operand16<MODE_EXTENDED> (&cycles);
         inst_tst16 (reg_u);
-        cycles += 6;
-        break;
+        NEXT;
     /* stx */
-    case 0x9f:
-        ea = ea_direct ();
-        write16 (ea, reg_x);
-        inst_tst16 (reg_x);
-        cycles += 5;
-        break;
-    case 0xaf:
-        ea = ea_indexed (&cycles);
-        write16 (ea, reg_x);
-        inst_tst16 (reg_x);
-        cycles += 5;
-        break;
-    case 0xbf:
-        ea = ea_extended ();
-        write16 (ea, reg_x);
-        inst_tst16 (reg_x);
-        cycles += 6;
-        break;
+    OPCODE (page0, 9f)
+        store16<MODE_DIRECT> (&reg_x, &cycles);
+        NEXT;
+    OPCODE (page0, af)
+        store16<MODE_INDEXED> (&reg_x, &cycles);
+        NEXT;
+    OPCODE (page0, bf)
+        store16<MODE_EXTENDED> (&reg_x, &cycles);
+        NEXT;
     /* stu */
-    case 0xdf:
-        ea = ea_direct ();
-        write16 (ea, reg_u);
-        inst_tst16 (reg_u);
-        cycles += 5;
-        break;
-    case 0xef:
-        ea = ea_indexed (&cycles);
-        write16 (ea, reg_u);
-        inst_tst16 (reg_u);
-        cycles += 5;
-        break;
-    case 0xff:
-        ea = ea_extended ();
-        write16 (ea, reg_u);
-        inst_tst16 (reg_u);
-        cycles += 6;
-        break;
+    OPCODE (page0, df)
+        store16<MODE_DIRECT> (&reg_u, &cycles);
+        NEXT;
+    OPCODE (page0, ef)
+        store16<MODE_INDEXED> (&reg_u, &cycles);
+        NEXT;
+    OPCODE (page0, ff)
+        store16<MODE_EXTENDED> (&reg_u, &cycles);
+        NEXT;
     /* addd */
-    case 0xc3:
-        set_reg_d (inst_add16 (get_reg_d (), pc_read16 ()));
-        cycles += 4;
-        break;
-    case 0xd3:
-        ea = ea_direct ();
-        set_reg_d (inst_add16 (get_reg_d (), read16 (ea)));
-        cycles += 6;
-        break;
-    case 0xe3:
-        ea = ea_indexed (&cycles);
-        set_reg_d (inst_add16 (get_reg_d (), read16 (ea)));
-        cycles += 6;
-        break;
-    case 0xf3:
-        ea = ea_extended ();
-        set_reg_d (inst_add16 (get_reg_d (), read16 (ea)));
-        cycles += 7;
-        break;
+    OPCODE (page0, c3)
+        set_reg_d (inst_add16 (get_reg_d (), operand16<MODE_IMMEDIATE16> (&cycles)));
+        NEXT;
+    OPCODE (page0, d3)
+        set_reg_d (inst_add16 (get_reg_d (), operand16<MODE_DIRECT> (&cycles)));
+        NEXT;
+    OPCODE (page0, e3)
+        set_reg_d (inst_add16 (get_reg_d (), operand16<MODE_INDEXED> (&cycles)));
+        NEXT;
+    OPCODE (page0, f3)
+        set_reg_d (inst_add16 (get_reg_d (), operand16<MODE_EXTENDED> (&cycles)));
+        NEXT;
     /* ldd */
-    case 0xcc:
-        set_reg_d (pc_read16 ());
+    OPCODE (page0, cc)
+        set_reg_d (operand16<MODE_IMMEDIATE16> (&cycles));
         inst_tst16 (get_reg_d ());
-        cycles += 3;
-        break;
-    case 0xdc:
-        ea = ea_direct ();
-        set_reg_d (read16 (ea));
+        NEXT;
+    OPCODE (page0, dc)
+        set_reg_d (operand16<MODE_DIRECT> (&cycles));
         inst_tst16 (get_reg_d ());
-        cycles += 5;
-        break;
-    case 0xec:
-        ea = ea_indexed (&cycles);
-        set_reg_d (read16 (ea));
+        NEXT;
+    OPCODE (page0, ec)
+        set_reg_d (operand16<MODE_INDEXED> (&cycles));
         inst_tst16 (get_reg_d ());
-        cycles += 5;
-        break;
-    case 0xfc:
-        ea = ea_extended ();
-        set_reg_d (read16 (ea));
+        NEXT;
+    OPCODE (page0, fc)
+        set_reg_d (operand16<MODE_EXTENDED> (&cycles));
         inst_tst16 (get_reg_d ());
-        cycles += 6;
-        break;
+        NEXT;
     /* std */
-    case 0xdd:
-        ea = ea_direct ();
+    OPCODE (page0, dd)
+        ea = ea_mode<MODE_DIRECT> (&cycles);
         write16 (ea, get_reg_d ());
         inst_tst16 (get_reg_d ());
-        cycles += 5;
-        break;
-    case 0xed:
-        ea = ea_indexed (&cycles);
+        NEXT;
+    OPCODE (page0, ed)
+        ea = ea_mode<MODE_INDEXED> (&cycles);
         write16 (ea, get_reg_d ());
         inst_tst16 (get_reg_d ());
-        cycles += 5;
-        break;
-    case 0xfd:
-        ea = ea_extended ();
+        NEXT;
+    OPCODE (page0, fd)
+        ea = ea_mode<MODE_EXTENDED> (&cycles);
         write16 (ea, get_reg_d ());
         inst_tst16 (get_reg_d ());
-        cycles += 6;
-        break;
+        NEXT;
     /* nop */
-    case 0x12:
-        cycles += 2;
-        break;
+    OPCODE (page0, 12)
+        NEXT;
     /* mul */
-    case 0x3d:
+    OPCODE (page0, 3d)
         r = (reg_a & 0xff) * (reg_b & 0xff);
         set_reg_d (r);
 
         set_cc (FLAG_Z, test_z16 (r));
         set_cc (FLAG_C, (r >> 7) & 1);
 
-        cycles += 11;
-        break;
+        NEXT;
     /* bra */
-    case 0x20:
+    OPCODE (page0, 20)
     /* brn */
-    case 0x21:
-        inst_bra8 (0, op, &cycles);
-        break;
+    OPCODE (page0, 21)
+        inst_bra8 (0, op);
+        NEXT_BRANCH;
     /* bhi */
-    case 0x22:
+    OPCODE (page0, 22)
     /* bls */
-    case 0x23:
-        inst_bra8 (get_cc (FLAG_C) | get_cc (FLAG_Z), op, &cycles);
-        break;
+    OPCODE (page0, 23)
+        inst_bra8 (get_cc (FLAG_C) | get_cc (FLAG_Z), op);
+        NEXT_BRANCH;
     /* bhs/bcc */
-    case 0x24:
+    OPCODE (page0, 24)
     /* blo/bcs */
-    case 0x25:
-        inst_bra8 (get_cc (FLAG_C), op, &cycles);
-        break;
+    OPCODE (page0, 25)
+        inst_bra8 (get_cc (FLAG_C), op);
+        NEXT_BRANCH;
     /* bne */
-    case 0x26:
+    OPCODE (page0, 26)
     /* beq */
-    case 0x27:
-        inst_bra8 (get_cc (FLAG_Z), op, &cycles);
-        break;
+    OPCODE (page0, 27)
+        inst_bra8 (get_cc (FLAG_Z), op);
+        NEXT_BRANCH;
     /* bvc */
-    case 0x28:
+    OPCODE (page0, 28)
     /* bvs */
-    case 0x29:
-        inst_bra8 (get_cc (FLAG_V), op, &cycles);
-        break;
+    OPCODE (page0, 29)
+        inst_bra8 (get_cc (FLAG_V), op);
+        NEXT_BRANCH;
     /* bpl */
-    case 0x2a:
+    OPCODE (page0, 2a)
     /* bmi */
-    case 0x2b:
-        inst_bra8 (get_cc (FLAG_N), op, &cycles);
-        break;
+    OPCODE (page0, 2b)
+        inst_bra8 (get_cc (FLAG_N), op);
+        NEXT_BRANCH;
     /* bge */
-    case 0x2c:
+    OPCODE (page0, 2c)
     /* blt */
-    case 0x2d:
-        inst_bra8 (get_cc (FLAG_N) ^ get_cc (FLAG_V), op, &cycles);
-        break;
+    OPCODE (page0, 2d)
+        inst_bra8 (get_cc (FLAG_N) ^ get_cc (FLAG_V), op);
+        NEXT_BRANCH;
     /* bgt */
-    case 0x2e:
+    OPCODE (page0, 2e)
     /* ble */
-    case 0x2f:
+    OPCODE (page0, 2f)
         inst_bra8 (get_cc (FLAG_Z) |
-                   (get_cc (FLAG_N) ^ get_cc (FLAG_V)), op, &cycles);
-        break;
+                   (get_cc (FLAG_N) ^ get_cc (FLAG_V)), op);
+        NEXT_BRANCH;
     /* lbra */
-    case 0x16:
-        r = pc_read16 ();
-        reg_pc += r;
-        cycles += 5;
-        break;
+    OPCODE (page0, 16)
+        reg_pc += inst->operand;
+        NEXT_BRANCH;
     /* lbsr */
-    case 0x17:
-        r = pc_read16 ();
+    OPCODE (page0, 17)
         push16 (&reg_s, reg_pc);
-        reg_pc += r;
-        cycles += 9;
-        break;
+        reg_pc += inst->operand;
+        NEXT;
     /* bsr */
-    case 0x8d:
-        r = pc_read8 ();
+    OPCODE (page0, 8d)
         push16 (&reg_s, reg_pc);
-        reg_pc += sign_extend (r);
-        cycles += 7;
-        break;
+        reg_pc += inst->operand;
+        NEXT;
     /* jsr */
-    case 0x9d:
-        ea = ea_direct ();
+    OPCODE (page0, 9d)
+        ea = ea_mode<MODE_DIRECT> (&cycles);
         push16 (&reg_s, reg_pc);
         reg_pc = ea;
-        cycles += 7;
-        break;
-    case 0xad:
-        ea = ea_indexed (&cycles);
+        NEXT;
+    OPCODE (page0, ad)
+        ea = ea_mode<MODE_INDEXED> (&cycles);
         push16 (&reg_s, reg_pc);
         reg_pc = ea;
-        cycles += 7;
-        break;
-    case 0xbd:
-        ea = ea_extended ();
+        NEXT;
+    OPCODE (page0, bd)
+        ea = ea_mode<MODE_EXTENDED> (&cycles);
         push16 (&reg_s, reg_pc);
         reg_pc = ea;
-        cycles += 8;
-        break;
+        NEXT;
     /* leax */
-    case 0x30:
-        reg_x = ea_indexed (&cycles);
+    OPCODE (page0, 30)
+        reg_x = ea_mode<MODE_INDEXED> (&cycles);
         set_cc (FLAG_Z, test_z16 (reg_x));
-        cycles += 4;
-        break;
+        NEXT;
     /* leay */
-    case 0x31:
-        reg_y = ea_indexed (&cycles);
+    OPCODE (page0, 31)
+        reg_y = ea_mode<MODE_INDEXED> (&cycles);
         set_cc (FLAG_Z, test_z16 (reg_y));
-        cycles += 4;
-        break;
+        NEXT;
     /* leas */
-    case 0x32:
-        reg_s = ea_indexed (&cycles);
-        cycles += 4;
-        break;
+    OPCODE (page0, 32)
+        reg_s = ea_mode<MODE_INDEXED> (&cycles);
+        NEXT;
     /* leau */
-    case 0x33:
-        reg_u = ea_indexed (&cycles);
-        cycles += 4;
-        break;
+    OPCODE (page0, 33)
+        reg_u = ea_mode<MODE_INDEXED> (&cycles);
+        NEXT;
     /* pshs */
-    case 0x34:
-        inst_psh (pc_read8 (), &reg_s, reg_u, &cycles);
-        cycles += 5;
-        break;
+    OPCODE (page0, 34)
+        inst_psh (inst->operand, &reg_s, reg_u, &cycles);
+        NEXT;
     /* puls */
-    case 0x35:
-        inst_pul (pc_read8 (), &reg_s, &reg_u, &cycles);
-        cycles += 5;
-        break;
+    OPCODE (page0, 35)
+        inst_pul (inst->operand, &reg_s, &reg_u, &cycles);
+        NEXT;
     /* pshu */
-    case 0x36:
-        inst_psh (pc_read8 (), &reg_u, reg_s, &cycles);
-        cycles += 5;
-        break;
+    OPCODE (page0, 36)
+        inst_psh (inst->operand, &reg_u, reg_s, &cycles);
+        NEXT;
     /* pulu */
-    case 0x37:
-        inst_pul (pc_read8 (), &reg_u, &reg_s, &cycles);
-        cycles += 5;
-        break;
+    OPCODE (page0, 37)
+        inst_pul (inst->operand, &reg_u, &reg_s, &cycles);
+        NEXT;
     /* rts */
-    case 0x39:
+    OPCODE (page0, 39)
         reg_pc = pull16 (&reg_s);
-        cycles += 5;
-        break;
+        NEXT;
     /* abx */
-    case 0x3a:
+    OPCODE (page0, 3a)
         reg_x += reg_b & 0xff;
-        cycles += 3;
-        break;
+        NEXT;
     /* orcc */
-    case 0x1a:
-        reg_cc |= pc_read8 ();
-        cycles += 3;
-        break;
+    OPCODE (page0, 1a)
+        set_reg_cc (get_reg_cc () | inst->operand);
+        NEXT;
     /* andcc */
-    case 0x1c:
-        reg_cc &= pc_read8 ();
-        cycles += 3;
-        break;
+    OPCODE (page0, 1c)
+        set_reg_cc (get_reg_cc () & inst->operand);
+        NEXT;
     /* sex */
-    case 0x1d:
+    OPCODE (page0, 1d)
         set_reg_d (sign_extend (reg_b));
         set_cc (FLAG_N, test_n (reg_a));
         set_cc (FLAG_Z, test_z16 (get_reg_d ()));
-        cycles += 2;
-        break;
+        NEXT;
     /* exg */
-    case 0x1e:
+    OPCODE (page0, 1e)
         inst_exg ();
-        cycles += 8;
-        break;
+        NEXT;
     /* tfr */
-    case 0x1f:
+    OPCODE (page0, 1f)
         inst_tfr ();
-        cycles += 6;
-        break;
+        NEXT;
     /* rti */
-    case 0x3b:
+    OPCODE (page0, 3b)
         if (get_cc (FLAG_E)) {
             inst_pul (0xff, &reg_s, &reg_u, &cycles);
         } else {
             inst_pul (0x81, &reg_s, &reg_u, &cycles);
         }
 
-        cycles += 3;
-        break;
+        NEXT;
     /* swi */
-    case 0x3f:
+    OPCODE (page0, 3f)
         set_cc (FLAG_E, 1);
         inst_psh (0xff, &reg_s, reg_u, &cycles);
         set_cc (FLAG_I, 1);
         set_cc (FLAG_F, 1);
         reg_pc = read16 (0xfffa);
-        cycles += 7;
-        break;
+        NEXT;
     /* sync */
-    case 0x13:
+    OPCODE (page0, 13)
         irq_status = IRQ_SYNC;
-        cycles += 2;
-        break;
+        goto step_done;
     /* daa */
-    case 0x19:
+    OPCODE (page0, 19)
         i0 = reg_a;
         i1 = 0;
 
@@ -2336,276 +2689,375 @@ unsigned Vec3XEmulator6809::Step(unsigned irq_i, unsigned irq_f)
         set_cc (FLAG_Z, test_z8 (reg_a));
         set_cc (FLAG_V, 0);
         set_cc (FLAG_C, test_c (i0, i1, reg_a, 0));
-        cycles += 2;
-        break;
+        NEXT;
     /* cwai */
-    case 0x3c:
-        reg_cc &= pc_read8 ();
+    OPCODE (page0, 3c)
+        set_reg_cc (get_reg_cc () & inst->operand);
         set_cc (FLAG_E, 1);
         inst_psh (0xff, &reg_s, reg_u, &cycles);
         irq_status = IRQ_CWAI;
-        cycles += 4;
-        break;
+        goto step_done;
 
     /* page 1 instructions */
 
-    case 0x10:
-        op = pc_read8 ();
+    /* lbra */
+    OPCODE (page1, 20)
+    /* lbrn */
+    OPCODE (page1, 21)
+        inst_bra16 (0, op, &cycles);
+        NEXT_BRANCH;
+    /* lbhi */
+    OPCODE (page1, 22)
+    /* lbls */
+    OPCODE (page1, 23)
+        inst_bra16 (get_cc (FLAG_C) | get_cc (FLAG_Z), op, &cycles);
+        NEXT_BRANCH;
+    /* lbhs/lbcc */
+    OPCODE (page1, 24)
+    /* lblo/lbcs */
+    OPCODE (page1, 25)
+        inst_bra16 (get_cc (FLAG_C), op, &cycles);
+        NEXT_BRANCH;
+    /* lbne */
+    OPCODE (page1, 26)
+    /* lbeq */
+    OPCODE (page1, 27)
+        inst_bra16 (get_cc (FLAG_Z), op, &cycles);
+        NEXT_BRANCH;
+    /* lbvc */
+    OPCODE (page1, 28)
+    /* lbvs */
+    OPCODE (page1, 29)
+        inst_bra16 (get_cc (FLAG_V), op, &cycles);
+        NEXT_BRANCH;
+    /* lbpl */
+    OPCODE (page1, 2a)
+    /* lbmi */
+    OPCODE (page1, 2b)
+        inst_bra16 (get_cc (FLAG_N), op, &cycles);
+        NEXT_BRANCH;
+    /* lbge */
+    OPCODE (page1, 2c)
+    /* lblt */
+    OPCODE (page1, 2d)
+        inst_bra16 (get_cc (FLAG_N) ^ get_cc (FLAG_V), op, &cycles);
+        NEXT_BRANCH;
+    /* lbgt */
+    OPCODE (page1, 2e)
+    /* lble */
+    OPCODE (page1, 2f)
+        inst_bra16 (get_cc (FLAG_Z) |
+                    (get_cc (FLAG_N) ^ get_cc (FLAG_V)), op, &cycles);
+        NEXT_BRANCH;
+    /* cmpd */
+    OPCODE (page1, 83)
+        inst_sub16 (get_reg_d (), operand16<MODE_IMMEDIATE16> (&cycles));
+        NEXT;
+    OPCODE (page1, 93)
+        inst_sub16 (get_reg_d (), operand16<MODE_DIRECT> (&cycles));
+        NEXT;
+    OPCODE (page1, a3)
+        inst_sub16 (get_reg_d (), operand16<MODE_INDEXED> (&cycles));
+        NEXT;
+    OPCODE (page1, b3)
+        inst_sub16 (get_reg_d (), operand16<MODE_EXTENDED> (&cycles));
+        NEXT;
+    /* cmpy */
+    OPCODE (page1, 8c)
+        compare16<MODE_IMMEDIATE16> (&reg_y, &cycles);
+        NEXT;
+    OPCODE (page1, 9c)
+        compare16<MODE_DIRECT> (&reg_y, &cycles);
+        NEXT;
+    OPCODE (page1, ac)
+        compare16<MODE_INDEXED> (&reg_y, &cycles);
+        NEXT;
+    OPCODE (page1, bc)
+        compare16<MODE_EXTENDED> (&reg_y, &cycles);
+        NEXT;
+    /* ldy */
+    OPCODE (page1, 8e)
+        reg_y = operand16<MODE_IMMEDIATE16> (&cycles);
+        inst_tst16 (reg_y);
+        NEXT;
+    OPCODE (page1, 9e)
+        reg_y = operand16<MODE_DIRECT> (&cycles);
+        inst_tst16 (reg_y);
+        NEXT;
+    OPCODE (page1, ae)
+        reg_y = operand16<MODE_INDEXED> (&cycles);
+        inst_tst16 (reg_y);
+        NEXT;
+    OPCODE (page1, be)
+        reg_y = operand16<MODE_EXTENDED> (&cycles);
+        inst_tst16 (reg_y);
+        NEXT;
+    /* sty */
+    OPCODE (page1, 9f)
+        store16<MODE_DIRECT> (&reg_y, &cycles);
+        NEXT;
+    OPCODE (page1, af)
+        store16<MODE_INDEXED> (&reg_y, &cycles);
+        NEXT;
+    OPCODE (page1, bf)
+        store16<MODE_EXTENDED> (&reg_y, &cycles);
+        NEXT;
+    /* lds */
+    OPCODE (page1, ce)
+        reg_s = operand16<MODE_IMMEDIATE16> (&cycles);
+        inst_tst16 (reg_s);
+        NEXT;
+    OPCODE (page1, de)
+        reg_s = operand16<MODE_DIRECT> (&cycles);
+        inst_tst16 (reg_s);
+        NEXT;
+    OPCODE (page1, ee)
+        reg_s = operand16<MODE_INDEXED> (&cycles);
+        inst_tst16 (reg_s);
+        NEXT;
+    OPCODE (page1, fe)
+        reg_s = operand16<MODE_EXTENDED> (&cycles);
+        inst_tst16 (reg_s);
+        NEXT;
+    /* sts */
+    OPCODE (page1, df)
+        store16<MODE_DIRECT> (&reg_s, &cycles);
+        NEXT;
+    OPCODE (page1, ef)
+        store16<MODE_INDEXED> (&reg_s, &cycles);
+        NEXT;
+    OPCODE (page1, ff)
+        store16<MODE_EXTENDED> (&reg_s, &cycles);
+        NEXT;
+    /* swi2 */
+    OPCODE (page1, 3f)
+        set_cc (FLAG_E, 1);
+        inst_psh (0xff, &reg_s, reg_u, &cycles);
+        reg_pc = read16 (0xfff4);
+        NEXT;
+    ILLEGAL_OPCODE (page1)
+        platform_print("unknown page-1 op code"); // printf ("unknown page-1 op code: %.2x\n", op);
+        NEXT;
 
-        switch (op) {
-        /* lbra */
-        case 0x20:
-        /* lbrn */
-        case 0x21:
-            inst_bra16 (0, op, &cycles);
-            break;
-        /* lbhi */
-        case 0x22:
-        /* lbls */
-        case 0x23:
-            inst_bra16 (get_cc (FLAG_C) | get_cc (FLAG_Z), op, &cycles);
-            break;
-        /* lbhs/lbcc */
-        case 0x24:
-        /* lblo/lbcs */
-        case 0x25:
-            inst_bra16 (get_cc (FLAG_C), op, &cycles);
-            break;
-        /* lbne */
-        case 0x26:
-        /* lbeq */
-        case 0x27:
-            inst_bra16 (get_cc (FLAG_Z), op, &cycles);
-            break;
-        /* lbvc */
-        case 0x28:
-        /* lbvs */
-        case 0x29:
-            inst_bra16 (get_cc (FLAG_V), op, &cycles);
-            break;
-        /* lbpl */
-        case 0x2a:
-        /* lbmi */
-        case 0x2b:
-            inst_bra16 (get_cc (FLAG_N), op, &cycles);
-            break;
-        /* lbge */
-        case 0x2c:
-        /* lblt */
-        case 0x2d:
-            inst_bra16 (get_cc (FLAG_N) ^ get_cc (FLAG_V), op, &cycles);
-            break;
-        /* lbgt */
-        case 0x2e:
-        /* lble */
-        case 0x2f:
-            inst_bra16 (get_cc (FLAG_Z) |
-                        (get_cc (FLAG_N) ^ get_cc (FLAG_V)), op, &cycles);
-            break;
-        /* cmpd */
-        case 0x83:
-            inst_sub16 (get_reg_d (), pc_read16 ());
-            cycles += 5;
-            break;
-        case 0x93:
-            ea = ea_direct ();
-            inst_sub16 (get_reg_d (), read16 (ea));
-            cycles += 7;
-            break;
-        case 0xa3:
-            ea = ea_indexed (&cycles);
-            inst_sub16 (get_reg_d (), read16 (ea));
-            cycles += 7;
-            break;
-        case 0xb3:
-            ea = ea_extended ();
-            inst_sub16 (get_reg_d (), read16 (ea));
-            cycles += 8;
-            break;
-        /* cmpy */
-        case 0x8c:
-            inst_sub16 (reg_y, pc_read16 ());
-            cycles += 5;
-            break;
-        case 0x9c:
-            ea = ea_direct ();
-            inst_sub16 (reg_y, read16 (ea));
-            cycles += 7;
-            break;
-        case 0xac:
-            ea = ea_indexed (&cycles);
-            inst_sub16 (reg_y, read16 (ea));
-            cycles += 7;
-            break;
-        case 0xbc:
-            ea = ea_extended ();
-            inst_sub16 (reg_y, read16 (ea));
-            cycles += 8;
-            break;
-        /* ldy */
-        case 0x8e:
-            reg_y = pc_read16 ();
-            inst_tst16 (reg_y);
-            cycles += 4;
-            break;
-        case 0x9e:
-            ea = ea_direct ();
-            reg_y = read16 (ea);
-            inst_tst16 (reg_y);
-            cycles += 6;
-            break;
-        case 0xae:
-            ea = ea_indexed (&cycles);
-            reg_y = read16 (ea);
-            inst_tst16 (reg_y);
-            cycles += 6;
-            break;
-        case 0xbe:
-            ea = ea_extended ();
-            reg_y = read16 (ea);
-            inst_tst16 (reg_y);
-            cycles += 7;
-            break;
-        /* sty */
-        case 0x9f:
-            ea = ea_direct ();
-            write16 (ea, reg_y);
-            inst_tst16 (reg_y);
-            cycles += 6;
-            break;
-        case 0xaf:
-            ea = ea_indexed (&cycles);
-            write16 (ea, reg_y);
-            inst_tst16 (reg_y);
-            cycles += 6;
-            break;
-        case 0xbf:
-            ea = ea_extended ();
-            write16 (ea, reg_y);
-            inst_tst16 (reg_y);
-            cycles += 7;
-            break;
-        /* lds */
-        case 0xce:
-            reg_s = pc_read16 ();
-            inst_tst16 (reg_s);
-            cycles += 4;
-            break;
-        case 0xde:
-            ea = ea_direct ();
-            reg_s = read16 (ea);
-            inst_tst16 (reg_s);
-            cycles += 6;
-            break;
-        case 0xee:
-            ea = ea_indexed (&cycles);
-            reg_s = read16 (ea);
-            inst_tst16 (reg_s);
-            cycles += 6;
-            break;
-        case 0xfe:
-            ea = ea_extended ();
-            reg_s = read16 (ea);
-            inst_tst16 (reg_s);
-            cycles += 7;
-            break;
-        /* sts */
-        case 0xdf:
-            ea = ea_direct ();
-            write16 (ea, reg_s);
-            inst_tst16 (reg_s);
-            cycles += 6;
-            break;
-        case 0xef:
-            ea = ea_indexed (&cycles);
-            write16 (ea, reg_s);
-            inst_tst16 (reg_s);
-            cycles += 6;
-            break;
-        case 0xff:
-            ea = ea_extended ();
-            write16 (ea, reg_s);
-            inst_tst16 (reg_s);
-            cycles += 7;
-            break;
-        /* swi2 */
-        case 0x3f:
-            set_cc (FLAG_E, 1);
-            inst_psh (0xff, &reg_s, reg_u, &cycles);
-            reg_pc = read16 (0xfff4);
-            cycles += 8;
-            break;
-        default:
-            platform_print("unknown page-1 op code"); // printf ("unknown page-1 op code: %.2x\n", op);
-            break;
+    /* page 2 instructions */
+
+    /* cmpu */
+    OPCODE (page2, 83)
+        compare16<MODE_IMMEDIATE16> (&reg_u, &cycles);
+        NEXT;
+    OPCODE (page2, 93)
+        compare16<MODE_DIRECT> (&reg_u, &cycles);
+        NEXT;
+    OPCODE (page2, a3)
+        compare16<MODE_INDEXED> (&reg_u, &cycles);
+        NEXT;
+    OPCODE (page2, b3)
+        compare16<MODE_EXTENDED> (&reg_u, &cycles);
+        NEXT;
+    /* cmps */
+    OPCODE (page2, 8c)
+        compare16<MODE_IMMEDIATE16> (&reg_s, &cycles);
+        NEXT;
+    OPCODE (page2, 9c)
+        compare16<MODE_DIRECT> (&reg_s, &cycles);
+        NEXT;
+    OPCODE (page2, ac)
+        compare16<MODE_INDEXED> (&reg_s, &cycles);
+        NEXT;
+    OPCODE (page2, bc)
+        compare16<MODE_EXTENDED> (&reg_s, &cycles);
+        NEXT;
+    /* swi3 */
+    OPCODE (page2, 3f)
+        set_cc (FLAG_E, 1);
+        inst_psh (0xff, &reg_s, reg_u, &cycles);
+        reg_pc = read16 (0xfff2);
+        NEXT;
+    ILLEGAL_OPCODE (page2)
+        platform_print("unknown page-2 op code"); // printf ("unknown page-2 op code: %.2x\n", op);
+        NEXT;
+
+    ILLEGAL_OPCODE (page0)
+        platform_print("unknown page-0 op code"); // printf ("unknown page-0 op code: %.2x\n", op);
+        NEXT;
+    END_DISPATCH
+
+step_done:
+    return cycles;
+}
+
+/* registers that make up the state of a wait loop */
+
+void Vec3XEmulator6809::loop_state (unsigned *state)
+{
+    state[0] = reg_a;
+    state[1] = reg_b;
+    state[2] = reg_x;
+    state[3] = reg_y;
+    state[4] = reg_u;
+    state[5] = reg_s;
+    state[6] = reg_dp;
+    state[7] = get_reg_cc ();
+}
+
+/* check that the loop from head to the branch at its end is straight code
+ * that does not write memory. i/o writes and reads with side effects end
+ * the run anyway, so repeating such a loop with the same registers gives
+ * the same result as long as the via does not change.
+ */
+
+unsigned Vec3XEmulator6809::loop_readonly (unsigned head, unsigned branch)
+{
+    const decoded_t *inst;
+    unsigned address, op, lo;
+
+    inst = decode (branch);
+    op = inst->bytes[0];
+
+    if (!(inst->mode == MODE_RELATIVE8 && op != 0x8d) &&
+        !(inst->mode == MODE_RELATIVE16 && op != 0x17)) {
+        return 0;
+    }
+
+    for (address = head; address < branch; address += inst->length) {
+        inst = decode (address);
+        op = inst->bytes[0];
+
+        if (inst->mode == MODE_ILLEGAL ||
+            inst->mode == MODE_RELATIVE8 || inst->mode == MODE_RELATIVE16) {
+            return 0;
         }
 
-        break;
+        if (op == 0x10 || op == 0x11) {
+            /* compares and loads of y, s, u */
 
-    /* page 2 instructions */
+            op = inst->bytes[1];
+            lo = op & 0x0f;
 
-    case 0x11:
-        op = pc_read8 ();
+            if (op < 0x80 || (lo != 0x3 && lo != 0xc && lo != 0xe)) {
+                return 0;
+            }
+
+            continue;
+        }
+
+        lo = op & 0x0f;
+
+        switch (op >> 4) {
+        case 0x0:
+        case 0x6:
+        case 0x7:
+            /* only tst leaves memory alone */
+
+            if (lo != 0xd) {
+                return 0;
+            }
 
-        switch (op) {
-        /* cmpu */
-        case 0x83:
-            inst_sub16 (reg_u, pc_read16 ());
-            cycles += 5;
-            break;
-        case 0x93:
-            ea = ea_direct ();
-            inst_sub16 (reg_u, read16 (ea));
-            cycles += 7;
-            break;
-        case 0xa3:
-            ea = ea_indexed (&cycles);
-            inst_sub16 (reg_u, read16 (ea));
-            cycles += 7;
-            break;
-        case 0xb3:
-            ea = ea_extended ();
-            inst_sub16 (reg_u, read16 (ea));
-            cycles += 8;
-            break;
-        /* cmps */
-        case 0x8c:
-            inst_sub16 (reg_s, pc_read16 ());
-            cycles += 5;
-            break;
-        case 0x9c:
-            ea = ea_direct ();
-            inst_sub16 (reg_s, read16 (ea));
-            cycles += 7;
             break;
-        case 0xac:
-            ea = ea_indexed (&cycles);
-            inst_sub16 (reg_s, read16 (ea));
-            cycles += 7;
+        case 0x1:
+            /* nop, daa, orcc, andcc, sex */
+
+            if (op != 0x12 && op != 0x19 && op != 0x1a && op != 0x1c && op != 0x1d) {
+                return 0;
+            }
+
             break;
-        case 0xbc:
-            ea = ea_extended ();
-            inst_sub16 (reg_s, read16 (ea));
-            cycles += 8;
+        case 0x2:
+            return 0;
+        case 0x3:
+            /* lea, abx, mul */
+
+            if (op > 0x33 && op != 0x3a && op != 0x3d) {
+                return 0;
+            }
+
             break;
-        /* swi3 */
-        case 0x3f:
-            set_cc (FLAG_E, 1);
-            inst_psh (0xff, &reg_s, reg_u, &cycles);
-            reg_pc = read16 (0xfff2);
-            cycles += 8;
+        case 0x4:
+        case 0x5:
             break;
         default:
-            platform_print("unknown page-2 op code"); // printf ("unknown page-2 op code: %.2x\n", op);
+            /* everything but stores and jsr */
+
+            if (lo == 0x7 || lo == 0xd || lo == 0xf) {
+                return 0;
+            }
+
             break;
         }
+    }
 
-        break;
+    return address == branch;
+}
 
-    default:
-        platform_print("unknown page-0 op code"); // printf ("unknown page-0 op code: %.2x\n", op);
-        break;
+/* called after a relative branch at address branch. for a short branch
+ * back: if the last iteration neither changed a register nor saw the via
+ * change, the following ones up to the next via event are identical and
+ * only take time, so the cycles are skipped. the loop is straight code, a
+ * pass that did not fall through the branch or get interrupted went from
+ * head to branch, so the cycles in between are exactly one pass.
+ */
+
+unsigned Vec3XEmulator6809::loop_check (unsigned branch, unsigned cycles, unsigned limit)
+{
+    unsigned state[RUN_LOOP_STATE], period, count;
+    long end;
+
+    if (reg_pc >= branch || branch - reg_pc > RUN_LOOP_BYTES) {
+        /* fell through the branch of the loop being timed */
+
+        if (branch == loop_branch) {
+            loop_pc = 0x10000;
+            loop_branch = 0;
+        }
+
+        return cycles;
     }
 
+    loop_state (state);
+
+    if (reg_pc == loop_pc && branch == loop_branch && loop_event >= (long) cycles &&
+        memcmp (state, loop_saved, sizeof (state)) == 0 &&
+        loop_readonly (reg_pc, branch)) {
+        period = cycles - loop_cycles;
+        end = loop_event < (long) limit ? loop_event : (long) limit;
+        count = (unsigned) ((end - (long) cycles) / (long) period);
+
+        cycles += count * period;
+    }
+
+    loop_pc = reg_pc;
+    loop_branch = branch;
+    loop_cycles = cycles;
+    loop_event = vectrex->ViaEventCycle();
+    memcpy (loop_saved, state, sizeof (state));
+
+    return cycles;
+}
+
+/* execute instructions until the budget is used up, an instruction accessed
+ * i/o in a way that may change the via or the irq line could change, which
+ * the caller says happens no earlier than nextEventCycle cycles from now.
+ * the caller runs the via for all these cycles afterwards, an i/o access
+ * brings it up to date with run_cycles first. Step only comes back early
+ * to take an interrupt.
+ */
+
+unsigned Vec3XEmulator6809::Run(long cycleBudget, long nextEventCycle, unsigned irq_i)
+{
+    unsigned cycles, limit;
+
+    limit = (unsigned) (cycleBudget < nextEventCycle ? cycleBudget : nextEventCycle);
+    cycles = 0;
+    run_stop = 0;
+    loop_pc = 0x10000;
+    loop_branch = 0;
+
+    do {
+        run_cycles = cycles;
+        cycles = Step (irq_i, 0, limit);
+    } while (cycles < limit && run_stop == 0);
+
+    run_cycles = 0;
+
     return cycles;
 }
@@ -5,16 +5,79 @@
 
 class Vec3XEmulator;
 
+enum {
+    FLAG_E      = 0x80,
+    FLAG_F      = 0x40,
+    FLAG_H      = 0x20,
+    FLAG_I      = 0x10,
+    FLAG_N      = 0x08,
+    FLAG_Z      = 0x04,
+    FLAG_V      = 0x02,
+    FLAG_C      = 0x01,
+    IRQ_NORMAL  = 0,
+    IRQ_SYNC    = 1,
+    IRQ_CWAI    = 2
+};
+
+// addressing modes of a decoded instruction
+enum {
+    MODE_ILLEGAL,
+    MODE_INHERENT,
+    MODE_IMMEDIATE8,
+    MODE_IMMEDIATE16,
+    MODE_DIRECT,
+    MODE_INDEXED,
+    MODE_EXTENDED,
+    MODE_RELATIVE8,
+    MODE_RELATIVE16,
+    MODE_PREFIX
+};
+
+enum {
+    DECODE_CART_SIZE = 0x8000,  // cartridge space, 0x0000-0x7fff
+    DECODE_ROM_SIZE  = 0x2000,  // bios rom, 0xe000-0xffff
+    DECODE_MAX_BYTES = 5,       // prefix + opcode + post byte + 16-bit offset
+    DECODE_PAGE_SIZE = 0x100,   // the cache is allocated one page of addresses at a time
+    DECODE_PAGES     = (DECODE_CART_SIZE + DECODE_ROM_SIZE) / DECODE_PAGE_SIZE
+};
+
+enum {
+    HANDLER_PAGE_SIZE = 0x100,  // handlers of opcode page n start at n * HANDLER_PAGE_SIZE
+    HANDLER_ILLEGAL   = 0x300,  // + page, handler of the illegal op codes of a page
+    HANDLER_COUNT     = 0x303
+};
+
+enum {
+    RUN_LOOP_BYTES = 16,        // longest loop body checked for a wait loop
+    RUN_LOOP_STATE = 8          // registers compared between loop iterations
+};
+
+typedef struct decoded_type {
+    unsigned char bytes[DECODE_MAX_BYTES];  // raw instruction bytes including the page prefix
+    unsigned char length;                   // number of valid bytes, 0 if not decoded yet
+    unsigned char mode;                     // addressing mode of the instruction
+    unsigned char cycles;                   // base cycle count of the instruction
+    unsigned short handler;                 // handler index, page prefix resolved
+    unsigned char post;                     // post byte of indexed addressing
+    unsigned char next;                     // offset of the following cache entry, 0 if it is not in this page
+    unsigned operand;                       // immediate data, address, direct page offset or branch/index offset
+} decoded_t;
+
 class Vec3XEmulator6809 {
 public:
     Vec3XEmulator6809(Vec3XEmulator* emulator);
+    ~Vec3XEmulator6809();
     
 public:
     void Reset();
-    unsigned Step(unsigned irq_i, unsigned irq_f);
+    void FlushCartridge();
+    unsigned Step(unsigned irq_i, unsigned irq_f, unsigned limit);
+    unsigned Run(long cycleBudget, long nextEventCycle, unsigned irq_i);
 
 public:
     unsigned GetRegister(int reg);
+    unsigned GetRunCycles() { return run_cycles; }
+    void StopRun() { run_stop = 1; }
     
 private:
     Vec3XEmulator* vectrex;
@@ -34,16 +97,33 @@ private:
     unsigned test_v(unsigned i0, unsigned i1, unsigned r);
     unsigned get_reg_d(void);
     void set_reg_d(unsigned value);
+    unsigned get_reg_cc(void);
+    void set_reg_cc(unsigned value);
+    void cc_defer(unsigned kind, unsigned mask, unsigned i0, unsigned i1, unsigned r);
+    void cc_update(unsigned mask);
     void push8(unsigned *sp, unsigned data);
     unsigned pull8(unsigned *sp);
     void push16(unsigned *sp, unsigned data);
     unsigned pull16(unsigned *sp);
-    unsigned pc_read8(void);
-    unsigned pc_read16(void);
+    const decoded_t* decode(unsigned address);
+    void decode_inst(decoded_t *inst, unsigned address);
+    void decode_cached(decoded_t *inst, unsigned address);
+    const decoded_t* decode_next(const decoded_t *inst, unsigned address);
+    void loop_state(unsigned *state);
+    unsigned loop_readonly(unsigned head, unsigned branch);
+    unsigned loop_check(unsigned branch, unsigned cycles, unsigned limit);
     unsigned sign_extend(unsigned data);
     unsigned ea_direct(void);
     unsigned ea_extended(void);
     unsigned ea_indexed(unsigned *cycles);
+    template <unsigned mode> unsigned ea_mode(unsigned *cycles);
+    template <unsigned mode> unsigned operand8(unsigned *cycles);
+    template <unsigned mode> unsigned operand16(unsigned *cycles);
+    template <unsigned mode, unsigned (Vec3XEmulator6809::*op)(unsigned)> void modify8(unsigned *cycles);
+    template <unsigned mode> void clear8(unsigned *cycles);
+    template <unsigned mode> void store8(unsigned *reg, unsigned *cycles);
+    template <unsigned mode> void store16(unsigned *reg, unsigned *cycles);
+    template <unsigned mode> void compare16(unsigned *reg, unsigned *cycles);
     unsigned inst_neg(unsigned data);
     unsigned inst_com(unsigned data);
     unsigned inst_lsr(unsigned data);
@@ -65,7 +145,7 @@ private:
     unsigned inst_add8(unsigned data0, unsigned data1);
     unsigned inst_add16(unsigned data0, unsigned data1);
     unsigned inst_sub16(unsigned data0, unsigned data1);
-    void inst_bra8(unsigned test, unsigned op, unsigned *cycles);
+    void inst_bra8(unsigned test, unsigned op);
     void inst_bra16(unsigned test, unsigned op, unsigned *cycles);
     void inst_psh(unsigned op, unsigned *sp, unsigned data, unsigned *cycles);
     void inst_pul(unsigned op, unsigned *sp, unsigned *osp, unsigned *cycles);
@@ -83,8 +163,26 @@ private:
     unsigned reg_a;      // accumulators
     unsigned reg_b;
     unsigned reg_dp;     // direct page register
-    unsigned reg_cc;     // condition codes
+    unsigned reg_cc;     // condition codes, see cc_mask
+    unsigned cc_kind;    // last instruction with deferred flags
+    unsigned cc_mask;    // flags not yet computed into reg_cc
+    unsigned cc_i0;      // inputs and result of that instruction
+    unsigned cc_i1;
+    unsigned cc_r;
     unsigned irq_status; // flag to see if interrupts should be handled (sync/cwait)
+    unsigned run_cycles = 0; // cycles of the instructions completed in the current run
+    unsigned run_stop = 0;   // an i/o access ended the current run
+    unsigned loop_pc = 0x10000;  // head of the wait loop being timed, see loop_check
+    unsigned loop_branch = 0;    // branch at its end
+    unsigned loop_cycles = 0;    // run cycles when the branch was last taken
+    long loop_event = 0;         // next via event seen then
+    unsigned loop_saved[RUN_LOOP_STATE] = {};  // registers seen then
     
     unsigned *rptr_xyus[4] = {0, 0, 0, 0};
+
+    // decoded instruction cache for the read-only cartridge and rom space,
+    // a page is allocated when code in it runs for the first time
+    decoded_t *decode_pages[DECODE_PAGES] = {};
+    decoded_t decode_ram = {};        // scratch entry for code running outside of the cache
+    const decoded_t *current = NULL;  // instruction being executed
 };
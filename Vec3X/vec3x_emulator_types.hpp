@@ -28,8 +28,42 @@ enum {
 enum {
     VECTREX_PDECAY = 30,                            // phosphor decay rate
     FCYCLES_INIT = VECTREX_MHZ / VECTREX_PDECAY,    // number of 6809 cycles before a frame redraw
+    FRAME_SYNC_TIMEOUT = 2 * FCYCLES_INIT,          // longest game frame before DEBUG_FRAME_SYNC falls back to FCYCLES_INIT
     VECTOR_CNT = VECTREX_MHZ / VECTREX_PDECAY,      // max number of possible vectors that maybe on the screen at one time
-    VECTOR_HASH = 65521
+    VECTOR_LIST_INIT = 256,                         // initial size of a vector list, grown on demand up to VECTOR_CNT
+    VECTOR_HASH_INIT_BITS = 10,                     // initial vector hash size, doubled to stay at most half full
+    VECTOR_HASH_PROBE = 8                           // slots searched for a vector before giving up
+};
+
+enum {
+    RASTER_TILE_BITS = 5,                           // the incremental raster works on 32x32 pixel tiles
+    RASTER_TILE_SIZE = 1 << RASTER_TILE_BITS,
+    RASTER_RECTS_MAX = 64,                          // changed regions beyond this redraw the whole screen
+    RASTER_BAND_BITS = 6,                           // the parallel raster splits the screen into 64 row bands
+    RASTER_BAND_SIZE = 1 << RASTER_BAND_BITS,
+    RASTER_THREADS_MAX = 16
+};
+
+#define VECTOR_HASH_MUL 0x9e3779b97f4a7c15ULL      // multiplicative hash of the packed end points
+
+enum {
+    VECTOR_STREAM_SIZE = 4096                       // events the vector stream holds, a power of two
+};
+
+enum {
+    MEMORY_PAGE_SIZE = 256,                         // granularity of the cpu memory map
+    MEMORY_PAGES = 65536 / MEMORY_PAGE_SIZE,
+    CARTRIDGE_BANK_SIZE = 32768,                    // cartridge space seen by the cpu
+    CARTRIDGE_MAX_BANKS = 2                         // banks selected by via pb6
+};
+
+// formats the intensity buffer is converted to, see vectrex_emulator_pixels
+enum {
+    PIXEL_FORMAT_NONE,              // no conversion, vectrex_render_frame gets NULL
+    PIXEL_FORMAT_INTENSITY,         // one byte per pixel
+    PIXEL_FORMAT_RGBA,              // grey, alpha 255 where lit and 0 elsewhere
+    PIXEL_FORMAT_BGRA,              // same bytes as rgba while the image is grey
+    PIXEL_FORMAT_RGB565             // 16 bits per pixel, little endian
 };
 
 typedef enum _DebugCommand {
@@ -39,7 +73,15 @@ typedef enum _DebugCommand {
     DEBUG_MEM_EDIT, DEBUG_MEM_SHOWCHECKSUM,
     DEBUG_MEM_PAGEDOWN, DEBUG_MEM_PAGEUP,
     DEBUG_CURSOR_DOWN, DEBUG_CURSOR_UP,
-    DEBUG_LIVE_UPDATE
+    DEBUG_LIVE_UPDATE,
+    DEBUG_VECTOR_MERGE,
+    DEBUG_RASTER_BENCHMARK,
+    DEBUG_ANTIALIAS,
+    DEBUG_INCREMENTAL_RASTER,
+    DEBUG_RASTER_THREADS,
+    DEBUG_PHOSPHOR,
+    DEBUG_VECTOR_STREAM,
+    DEBUG_FRAME_SYNC
 } DebugCommand;
 
 enum {
@@ -54,12 +96,90 @@ enum {
     PL2_DOWN
 };
 
-typedef struct vector_type {
-    long x0, y0;             // start coordinate
-    long x1, y1;             // end coordinate
+// vectors stored one array per field, all carved from the block at x0.
+// coordinates are always inside the screen, 0..ALG_MAX_X-1 and 0..ALG_MAX_Y-1
+typedef struct vector_list_type {
+    unsigned short *x0, *y0; // start coordinates
+    unsigned short *x1, *y1; // end coordinates
+    unsigned *id;            // stays the same while the vector is redrawn every frame
+    unsigned char *color;    // 0..VECTREX_COLORS-1, VECTREX_COLORS marks an erased vector
+    unsigned char *kept;     // 1 if the vector was on screen with the same color last frame
+} vector_list_t;
+
+typedef struct vector_point_type {
+    unsigned short x, y;
+} vector_point_t;
+
+// consecutive draw list vectors joined end to end, see VectorMerge
+typedef struct vector_strip_type {
+    long first;              // index of the first point
+    long count;              // number of points, at least 2
     unsigned char color;     // 0..VECTREX_COLORS-1
-} vector_t;
+} vector_strip_t;
+
+// one rendered frame in screen coordinates, passed to vectrex_display_list.
+// the arrays belong to the emulator and are only valid during that call.
+// depending on DEBUG_VECTOR_MERGE it holds either lines or strips
+typedef struct display_list_type {
+    unsigned long frame;            // sequence number, one more for every rendered frame
+    unsigned long changed;          // frame number of the last frame with different content
+    int unchanged;                  // nonzero if the frame is the same as the last one
+    unsigned long long hash;        // of the draw list the frame was made from
+    long count;                     // number of lines
+    const int *lines;               // x0, y0, x1, y1 per line
+    const unsigned char *colors;    // intensity per line, 0..VECTREX_COLORS-1
+    long strip_count;               // number of strips
+    const vector_strip_t *strips;   // first and count index into points
+    const int *points;              // x, y per strip point
+    const unsigned *ids;            // stable id per line, NULL for strips
+    int reset;                      // nonzero if ids of earlier frames are no longer valid
+    long added_count;               // ids of lines that were not in the last frame
+    const unsigned *added;
+    long removed_count;             // ids of the last frame that are gone
+    const unsigned *removed;
+} display_list_t;
+
+// pixel rectangle, both corners inclusive
+typedef struct raster_rect_type {
+    int left, top;
+    int right, bottom;
+} raster_rect_t;
+
+// a line binned into a band of the parallel raster
+typedef struct raster_line_type {
+    const int *screen;       // x0, y0, x1, y1 in the display list
+    unsigned char color;     // 0..255
+} raster_line_t;
+
+enum {
+    VECTOR_EVENT_LINE,      // a line was added to the draw list
+    VECTOR_EVENT_FRAME      // the draw list was rendered, later lines belong to the next frame
+};
+
+// entry of the vector stream, see vectrex_emulator_read_stream
+typedef struct vector_event_type {
+    unsigned long long cycle;   // emulated cycle the line was finished or the frame rendered in
+    unsigned long frame;        // display list the line goes into, or the one just rendered
+    int type;                   // VECTOR_EVENT_LINE or VECTOR_EVENT_FRAME
+    unsigned id;                // stable id of the line, see display_list_t
+    int x0, y0, x1, y1;         // screen coordinates of the line
+    unsigned char color;        // 0..VECTREX_COLORS-1
+    unsigned long dropped;      // events lost since the last frame event, set on frame events
+} vector_event_t;
+
+typedef struct vector_slot_type {
+    unsigned long long key;  // end points packed into 16 bits each
+    unsigned gen;            // frame generation that added the entry, 0 if never used
+    unsigned index;          // into the draw or erase list, depending on gen
+} vector_slot_t;
+
+typedef struct vector_stats_type {
+    unsigned long hits;       // line already in the draw list
+    unsigned long misses;     // line added to the draw list
+    unsigned long collisions; // line not tracked, its probe window was full
+} vector_stats_t;
 
 typedef unsigned char byte;
 typedef uint8_t Uint8;
+typedef uint16_t Uint16;
 typedef uint32_t Uint32;